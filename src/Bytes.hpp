@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// Little endian encoding for the binary formats, input logs and the tile
+// protocol.
+inline void putU32(std::vector<unsigned char>& out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+inline void putU64(std::vector<unsigned char>& out, std::uint64_t value)
+{
+    putU32(out, static_cast<std::uint32_t>(value));
+    putU32(out, static_cast<std::uint32_t>(value >> 32));
+}
+
+inline void putFloat(std::vector<unsigned char>& out, float value)
+{
+    std::uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU32(out, bits);
+}
+
+inline void putDouble(std::vector<unsigned char>& out, double value)
+{
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+}
+
+// Reads from a byte buffer, throwing std::runtime_error when it runs out.
+// Name is the source of the bytes in the error message.
+class ByteReader {
+public:
+    ByteReader(const unsigned char* data,
+               std::size_t size,
+               const std::string& name)
+        : data_(data), size_(size), name_(name)
+    {
+    }
+
+    ByteReader(const std::vector<unsigned char>& data, const std::string& name)
+        : ByteReader(data.data(), data.size(), name)
+    {
+    }
+
+    auto done() const -> bool { return pos_ == size_; }
+
+    auto byte() -> unsigned char
+    {
+        need(1);
+        return data_[pos_++];
+    }
+
+    auto u32() -> std::uint32_t
+    {
+        need(4);
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= std::uint32_t(data_[pos_++]) << (8 * i);
+        }
+        return value;
+    }
+
+    auto u64() -> std::uint64_t
+    {
+        const auto low = u32();
+        return low | std::uint64_t(u32()) << 32;
+    }
+
+    auto f32() -> float
+    {
+        const auto bits = u32();
+        float value = 0.0f;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    auto f64() -> double
+    {
+        const auto bits = u64();
+        double value = 0.0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+private:
+    void need(std::size_t bytes) const
+    {
+        if (size_ - pos_ < bytes) {
+            throw std::runtime_error(name_ + " is truncated");
+        }
+    }
+
+    const unsigned char* data_;
+    std::size_t size_;
+    std::string name_;
+    std::size_t pos_ = 0;
+};
+
+} // namespace glFractals
@@ -52,6 +52,18 @@ Point2D<T> operator/(const Point2D<T>& p, T f)
     return {f / p.x, f / p.y};
 }
 
+template <typename T>
+bool operator==(const Point2D<T>& l, const Point2D<T>& r)
+{
+    return l.x == r.x && l.y == r.y;
+}
+
+template <typename T>
+bool operator!=(const Point2D<T>& l, const Point2D<T>& r)
+{
+    return !(l == r);
+}
+
 template <typename T>
 std::string str(const Point2D<T> p)
 {
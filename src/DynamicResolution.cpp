@@ -0,0 +1,52 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace glFractals {
+
+// Weight of a new measurement in the smoothed full resolution time. Results
+// arrive a few frames late, reacting fully to each would oscillate.
+static constexpr float SMOOTHING = 0.25f;
+// Scales are rounded down to this step, so small changes in the measurements
+// don't resize the frame every time.
+static constexpr float SCALE_STEP = 1.0f / 16.0f;
+
+constexpr float DynamicResolution::MIN_SCALE;
+
+DynamicResolution::DynamicResolution(float budget) : budget_(budget) {}
+
+void DynamicResolution::setBudget(float budget)
+{
+    budget_ = budget;
+    if (budget_ <= 0.0f) {
+        scale_ = 1.0f;
+    }
+}
+
+auto DynamicResolution::budget() const -> float { return budget_; }
+
+void DynamicResolution::addFrame(float seconds, float scale)
+{
+    if (scale <= 0.0f || !(seconds > 0.0f)) {
+        return;
+    }
+
+    const auto fullFrameTime = seconds / (scale * scale);
+    fullFrameTime_ = (fullFrameTime_ < 0.0f)
+                         ? fullFrameTime
+                         : fullFrameTime_ +
+                               SMOOTHING * (fullFrameTime - fullFrameTime_);
+
+    if (budget_ <= 0.0f) {
+        return;
+    }
+    // The pixel count goes with the square of the scale.
+    const auto target = std::sqrt(budget_ / fullFrameTime_);
+    const auto stepped = std::floor(target / SCALE_STEP) * SCALE_STEP;
+    scale_ = std::min(1.0f, std::max(MIN_SCALE, stepped));
+}
+
+auto DynamicResolution::scale() const -> float { return scale_; }
+
+} // namespace glFractals
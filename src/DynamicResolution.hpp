@@ -0,0 +1,33 @@
+#pragma once
+
+namespace glFractals {
+
+// Picks the fraction of the window resolution to render moving frames at, so
+// they take about budget seconds. The cost of a frame is assumed to grow with
+// its pixel count, so every measured frame gives an estimate of what a full
+// resolution frame would cost.
+class DynamicResolution {
+public:
+    // Moving frames never get smaller than this fraction of the window size.
+    static constexpr float MIN_SCALE = 0.25f;
+
+    // A budget of 0 always renders at full resolution.
+    explicit DynamicResolution(float budget = 0.0f);
+
+    void setBudget(float budget);
+    auto budget() const -> float;
+
+    // Adds the measured time of a frame rendered at scale.
+    void addFrame(float seconds, float scale);
+
+    // The scale for the next moving frame, 1 until frames were measured.
+    auto scale() const -> float;
+
+private:
+    float budget_ = 0.0f;
+    // Smoothed over the last frames, negative until the first one.
+    float fullFrameTime_ = -1.0f;
+    float scale_ = 1.0f;
+};
+
+} // namespace glFractals
@@ -0,0 +1,142 @@
+#include "Engines.hpp"
+
+#include "FormulaShader.hpp"
+
+namespace glFractals {
+
+auto buildShader(ProgramCache& cache,
+                 const std::string& vertexShader,
+                 const std::vector<std::string>& fragmentShaders,
+                 const std::string& generatedFragmentShader) -> Shader
+{
+    std::vector<Shader::Source> sources;
+    sources.push_back({Shader::Source::Type::VERTEX_SHADER,
+                       ROOT_PATH_STR + "/src/shaders/" + vertexShader});
+    // Fragment shaders are linked together, so one file can call functions
+    // declared in another.
+    for (const auto& fragmentShader : fragmentShaders) {
+        sources.push_back({Shader::Source::Type::FRAGMENT_SHADER,
+                           ROOT_PATH_STR + "/src/shaders/" + fragmentShader});
+    }
+    if (!generatedFragmentShader.empty()) {
+        sources.push_back({Shader::Source::Type::FRAGMENT_SHADER,
+                           "",
+                           generatedFragmentShader});
+    }
+    return Shader(sources, &cache);
+}
+
+auto buildFractalShaders(ProgramCache& cache,
+                         FractalType type,
+                         const Formula& formula) -> FractalShaders
+{
+    const auto fractalShader =
+        (type == FractalType::JULIA) ? "Julia.fs" : "Mandelbrot.fs";
+    const auto formulaShader = formulaShaderSource(formula);
+    return {buildShader(cache,
+                        "Fractal.vs",
+                        {"Iterations.fs", fractalShader, "Distance.fs"},
+                        formulaShader),
+            buildShader(cache,
+                        "Fractal.vs",
+                        {"Refine.fs",
+                         fractalShader,
+                         "Distance.fs",
+                         "Palette.fs",
+                         "Symmetry.fs"},
+                        formulaShader),
+            formula};
+}
+
+auto buildResolveShader(ProgramCache& cache) -> Shader
+{
+    return buildShader(
+        cache, "Fractal.vs", {"Resolve.fs", "Palette.fs", "Symmetry.fs"});
+}
+
+auto buildTextShader(ProgramCache& cache) -> Shader
+{
+    return buildShader(cache, "Text.vs", {"Text.fs"});
+}
+
+Engines::Engines(ProgramCache& programCache,
+                 const EngineOptions& options,
+                 Point2D<int> resolution)
+    : options_(options),
+      fractalShaders_(buildFractalShaders(
+          programCache, options.fractalType, options.formula)),
+      resolveShader_(buildResolveShader(programCache)),
+      fractalRenderer_(resolveShader_, resolution),
+      cpuRenderer_(options.cpuThreads)
+{
+    fractalRenderer_.setAntiAliasing(options.antiAliasing);
+    fractalRenderer_.setSymmetry(options.symmetry);
+    fractalRenderer_.setFrameBudget(options.frameBudget * 1e-3f);
+
+    cpuRenderer_.setMethod(options.cpuMethod);
+    cpuRenderer_.setArithmetic(options.cpuArithmetic);
+    cpuRenderer_.setSymmetry(options.symmetry);
+
+    buddhabrotRenderer_.setChannelIterations(options.channelIterations);
+    buddhabrotRenderer_.setSampleLimit(options.sampleLimit);
+    buddhabrotRenderer_.setSampling(options.sampling);
+}
+
+void Engines::render(const FractalParams& frameParams)
+{
+    if (options_.fractalType == FractalType::BUDDHABROT) {
+        // Keeps adding orbits to the density until the view changes.
+        buddhabrotRenderer_.render(frameParams, colors_);
+        fractalRenderer_.renderColors(colors_);
+        // Every batch of orbits changes the picture, until the limit.
+        frameFinished_ = buddhabrotRenderer_.samples() != buddhabrotSamples_;
+        buddhabrotSamples_ = buddhabrotRenderer_.samples();
+    }
+    else if (options_.engine == Engine::CPU) {
+        // Only rerender when something changed, the CPU is slow enough.
+        auto params = frameParams;
+        params.formula = options_.formula;
+        frameFinished_ = params != cpuParams_ || cpuValues_.empty();
+        if (frameFinished_) {
+            cpuRenderer_.render(params, cpuValues_);
+            cpuParams_ = params;
+        }
+        fractalRenderer_.render(cpuValues_);
+    }
+    else {
+        fractalRenderer_.render(fractalShaders_, frameParams);
+        frameFinished_ = fractalRenderer_.frameFinished();
+    }
+}
+
+void Engines::stateLines(HudText& hud) const
+{
+    if (options_.fractalType == FractalType::BUDDHABROT) {
+        buddhabrotRenderer_.stateLines(hud);
+    }
+    else if (options_.engine == Engine::CPU) {
+        cpuRenderer_.stateLines(hud);
+    }
+    else {
+        fractalRenderer_.stateLines(hud);
+    }
+}
+
+auto Engines::fractalRenderer() -> FractalRenderer& { return fractalRenderer_; }
+
+auto Engines::cpuValues() const -> const std::vector<float>&
+{
+    return cpuValues_;
+}
+
+auto Engines::frameFinished() const -> bool { return frameFinished_; }
+
+void Engines::readFrame(FrameReadback& readback,
+                        const FractalParams& frameParams)
+{
+    auto params = frameParams;
+    params.formula = options_.formula;
+    fractalRenderer_.readFrame(readback, params);
+}
+
+} // namespace glFractals
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "BuddhabrotRenderer.hpp"
+#include "Common.hpp"
+#include "CpuRenderer.hpp"
+#include "Formula.hpp"
+#include "FractalParams.hpp"
+#include "FractalRenderer.hpp"
+#include "FrameReadback.hpp"
+#include "HudText.hpp"
+#include "ProgramCache.hpp"
+#include "Shader.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+enum class Engine { GLSL, CPU };
+
+// What to render and how, shared by the viewer, headless rendering and the
+// benchmark.
+struct EngineOptions {
+    FractalType fractalType = FractalType::MANDELBROT;
+    Formula formula = {};
+    Engine engine = Engine::GLSL;
+    CpuRenderer::Method cpuMethod = CpuRenderer::Method::PER_PIXEL;
+    CpuRenderer::Arithmetic cpuArithmetic = CpuRenderer::Arithmetic::DOUBLE;
+    // 0 uses every hardware thread.
+    unsigned cpuThreads = 0;
+    AntiAliasing antiAliasing = {};
+    bool symmetry = true;
+    // Milliseconds, 0 always renders at full resolution.
+    float frameBudget = 12.0f;
+    // Buddhabrot only.
+    std::array<int, 3> channelIterations = {};
+    std::uint64_t sampleLimit = 0;
+    BuddhabrotRenderer::Sampling sampling =
+        BuddhabrotRenderer::Sampling::UNIFORM;
+};
+
+auto buildShader(ProgramCache& cache,
+                 const std::string& vertexShader,
+                 const std::vector<std::string>& fragmentShaders,
+                 const std::string& generatedFragmentShader = {}) -> Shader;
+auto buildFractalShaders(ProgramCache& cache,
+                         FractalType type,
+                         const Formula& formula) -> FractalShaders;
+auto buildResolveShader(ProgramCache& cache) -> Shader;
+auto buildTextShader(ProgramCache& cache) -> Shader;
+
+// The renderers of every engine for one GL context, drawing with the engine
+// the options pick.
+class Engines {
+public:
+    Engines(ProgramCache& programCache,
+            const EngineOptions& options,
+            Point2D<int> resolution);
+
+    void render(const FractalParams& frameParams);
+
+    void stateLines(HudText& hud) const;
+
+    // Every engine shows its frames through it.
+    auto fractalRenderer() -> FractalRenderer&;
+
+    // The values of the last frame the CPU engine rendered, one per pixel
+    // with rows bottom up.
+    auto cpuValues() const -> const std::vector<float>&;
+
+    // Whether the last render drew a new full resolution frame, rather than
+    // a preview or the last frame again.
+    auto frameFinished() const -> bool;
+    // Queues reading the last frame back, see FractalRenderer::readFrame.
+    void readFrame(FrameReadback& readback, const FractalParams& frameParams);
+
+private:
+    EngineOptions options_;
+
+    FractalShaders fractalShaders_;
+    Shader resolveShader_;
+    FractalRenderer fractalRenderer_;
+
+    CpuRenderer cpuRenderer_;
+    std::vector<float> cpuValues_;
+    FractalParams cpuParams_ = {};
+
+    BuddhabrotRenderer buddhabrotRenderer_;
+    std::vector<float> colors_;
+    std::uint64_t buddhabrotSamples_ = 0;
+
+    bool frameFinished_ = false;
+};
+
+} // namespace glFractals
@@ -12,6 +12,8 @@ enum class Event {
     INCREASE_ITERATIONS,
     DECREASE_ITERATIONS,
     RESET_CAMERA,
-    DRAG_SEED // Only for Julia fractals
+    DRAG_SEED, // Only for Julia fractals
+    TOGGLE_ANTIALIASING,
+    TOGGLE_DISTANCE_ESTIMATION
 };
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "Formula.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace glFractals {
+
+namespace {
+struct NamedFormula {
+    const char* name;
+    Formula formula;
+};
+} // namespace
+
+// The formula registry.
+static const NamedFormula FORMULAS[] = {
+    {"mandelbrot", {2, Fold::NONE}},
+    {"multibrot3", {3, Fold::NONE}},
+    {"multibrot4", {4, Fold::NONE}},
+    {"multibrot5", {5, Fold::NONE}},
+    {"burning-ship", {2, Fold::ABS}},
+    {"tricorn", {2, Fold::CONJUGATE}},
+};
+
+auto formulaByName(const std::string& name) -> Formula
+{
+    for (const auto& entry : FORMULAS) {
+        if (name == entry.name) {
+            return entry.formula;
+        }
+    }
+
+    std::stringstream ss;
+    ss << "unknown formula " << name << ", expected one of";
+    for (const auto& entry : FORMULAS) {
+        ss << " " << entry.name;
+    }
+    throw std::runtime_error(ss.str());
+}
+
+auto formulaName(const Formula& formula) -> std::string
+{
+    for (const auto& entry : FORMULAS) {
+        if (entry.formula == formula) {
+            return entry.name;
+        }
+    }
+
+    std::stringstream ss;
+    ss << "fold(z)^" << formula.power << " + c";
+    return ss.str();
+}
+
+auto formulaNames() -> std::vector<std::string>
+{
+    std::vector<std::string> names;
+    for (const auto& entry : FORMULAS) {
+        names.push_back(entry.name);
+    }
+    return names;
+}
+
+} // namespace glFractals
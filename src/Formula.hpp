@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// Applied to z before raising it to the power.
+enum class Fold {
+    NONE,
+    // Absolute value of both components, gives the Burning Ship.
+    ABS,
+    // Complex conjugate, gives the Tricorn.
+    CONJUGATE
+};
+
+// Highest power the CPU kernels are specialized for.
+static constexpr int MAX_FORMULA_POWER = 8;
+
+// The iteration z -> fold(z)^power + c. Both engines are generated from this,
+// the shaders from formulaShaderSource and the CPU kernels by
+// dispatchFormula, so a new formula only needs an entry in the registry.
+struct Formula {
+    int power = 2;
+    Fold fold = Fold::NONE;
+
+    // Whether Mandelbrot type views are symmetric about the real axis.
+    auto realAxisSymmetric() const -> bool { return fold != Fold::ABS; }
+    // Whether Julia sets are symmetric under z -> -z.
+    auto pointSymmetric() const -> bool
+    {
+        return fold == Fold::ABS || power % 2 == 0;
+    }
+    // Distance estimates only bound the distance for holomorphic formulas.
+    auto holomorphic() const -> bool { return fold == Fold::NONE; }
+};
+
+inline bool operator==(const Formula& l, const Formula& r)
+{
+    return l.power == r.power && l.fold == r.fold;
+}
+
+inline bool operator!=(const Formula& l, const Formula& r)
+{
+    return !(l == r);
+}
+
+// Looks a formula up in the registry. Throws std::runtime_error for unknown
+// names.
+auto formulaByName(const std::string& name) -> Formula;
+// Returns the registry name of formula, or a description when it has none.
+auto formulaName(const Formula& formula) -> std::string;
+auto formulaNames() -> std::vector<std::string>;
+
+} // namespace glFractals
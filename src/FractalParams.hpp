@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Formula.hpp"
+
+namespace glFractals {
+enum class FractalType {
+    MANDELBROT,
+    JULIA,
+    // Density of the escaping Mandelbrot orbits, only rendered on the CPU.
+    BUDDHABROT
+};
+
+enum class RenderMode {
+    // Colors by the iteration the point escaped at.
+    ESCAPE_TIME,
+    // Colors by the estimated distance to the set, so filaments thinner than
+    // a pixel still show up.
+    DISTANCE_ESTIMATE
+};
+
+// Everything an engine needs to render one frame.
+struct FractalParams {
+    FractalType type = FractalType::MANDELBROT;
+    RenderMode mode = RenderMode::ESCAPE_TIME;
+    Formula formula = {};
+    int iterations = 100;
+
+    Point2D<int> viewResolution = {};
+    Point2D<double> compCenter = {};
+    Point2D<double> compResolution = {};
+    // Only used by Julia fractals.
+    Point2D<double> seed = {};
+};
+
+inline bool operator==(const FractalParams& l, const FractalParams& r)
+{
+    return l.type == r.type && l.mode == r.mode && l.formula == r.formula &&
+           l.iterations == r.iterations &&
+           l.viewResolution == r.viewResolution &&
+           l.compCenter == r.compCenter &&
+           l.compResolution == r.compResolution && l.seed == r.seed;
+}
+
+inline bool operator!=(const FractalParams& l, const FractalParams& r)
+{
+    return !(l == r);
+}
+} // namespace glFractals
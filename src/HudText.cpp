@@ -0,0 +1,49 @@
+#include "HudText.hpp"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+namespace glFractals {
+
+constexpr int HudText::MAX_LINE_LENGTH;
+
+void HudText::clear() { size_ = 0; }
+
+void HudText::addLine(const char* format, ...)
+{
+    char buffer[MAX_LINE_LENGTH + 1];
+    va_list args;
+    va_start(args, format);
+    const auto length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (size_ == lines_.size()) {
+        lines_.emplace_back();
+    }
+    // Reuses the capacity of the line.
+    lines_[size_].assign(buffer,
+                         length < 0 ? 0
+                                    : std::min(length, MAX_LINE_LENGTH));
+    size_++;
+}
+
+void HudText::addLines(const HudText& other)
+{
+    for (std::size_t i = 0; i < other.size_; i++) {
+        if (size_ == lines_.size()) {
+            lines_.emplace_back();
+        }
+        lines_[size_] = other.lines_[i];
+        size_++;
+    }
+}
+
+auto HudText::size() const -> std::size_t { return size_; }
+
+auto HudText::line(std::size_t i) const -> const std::string&
+{
+    return lines_[i];
+}
+
+} // namespace glFractals
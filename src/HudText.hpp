@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// The lines of the HUD, written again every frame. Lines keep their storage
+// between frames and are formatted with snprintf, so once the lines fit in
+// what earlier frames used a frame doesn't allocate.
+class HudText {
+public:
+    // Longer lines are cut off.
+    static constexpr int MAX_LINE_LENGTH = 255;
+
+    // Starts the lines of a new frame.
+    void clear();
+    // Appends a line formatted like printf.
+    void addLine(const char* format, ...);
+    // Appends the lines of other.
+    void addLines(const HudText& other);
+
+    auto size() const -> std::size_t;
+    auto line(std::size_t i) const -> const std::string&;
+
+private:
+    // Lines past size_ are left over from frames with more lines.
+    std::vector<std::string> lines_;
+    std::size_t size_ = 0;
+};
+
+} // namespace glFractals
@@ -1,80 +1,760 @@
+#include "BuddhabrotRenderer.hpp"
 #include "Common.hpp"
+#include "CpuRenderer.hpp"
+#include "DebugOutput.hpp"
+#include "Engines.hpp"
 #include "Event.hpp"
+#include "Formula.hpp"
+#include "FractalParams.hpp"
 #include "FractalRenderer.hpp"
+#include "FrameReadback.hpp"
 #include "Framework.hpp"
+#include "GpuTimer.hpp"
+#ifdef HAVE_EGL
+#include "HeadlessContext.hpp"
+#endif
+#include "HudText.hpp"
+#include "InputLog.hpp"
+#include "KeyListener.hpp"
 #include "JuliaController.hpp"
 #include "MandelbrotController.hpp"
+#include "Profiler.hpp"
+#include "ProgramCache.hpp"
 #include "Shader.hpp"
+#ifdef HAVE_SHARED_MEMORY
+#include "SharedFrameRing.hpp"
+#endif
 #include "StateController.hpp"
+#include "Symmetry.hpp"
 #include "TextRenderer.hpp"
+#ifdef HAVE_SOCKETS
+#include "TileCoordinator.hpp"
+#include "TileImage.hpp"
+#include "TileServer.hpp"
+#include "TileWorker.hpp"
+#endif
+#include "TripleBuffer.hpp"
 
 #include "GLFW/glfw3.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
-enum class FractalType { MANDELBROT, JULIA };
+using glFractals::Engine;
+using glFractals::FractalType;
 
-auto buildFractalShader(FractalType type) -> glFractals::Shader
+auto stateControllerFactory(FractalType fractalType, Point2D<int> resolution)
+    -> std::unique_ptr<glFractals::StateController>
 {
-    std::vector<glFractals::Shader::Source> sources;
-    sources.push_back({glFractals::Shader::Source::Type::VERTEX_SHADER,
-                       ROOT_PATH_STR + "/src/shaders/Fractal.vs"});
-    if (type == FractalType::MANDELBROT) {
-        sources.push_back({glFractals::Shader::Source::Type::FRAGMENT_SHADER,
-                           ROOT_PATH_STR + "/src/shaders/Mandelbrot.fs"});
-    }
-    else if (type == FractalType::JULIA) {
-        sources.push_back({glFractals::Shader::Source::Type::FRAGMENT_SHADER,
-                           ROOT_PATH_STR + "/src/shaders/Julia.fs"});
-    }
-    return glFractals::Shader(sources);
+    if (fractalType == FractalType::JULIA) {
+        return std::make_unique<glFractals::JuliaController>(resolution);
+    }
+    else {
+        return std::make_unique<glFractals::MandelbrotController>(resolution,
+                                                                  fractalType);
+    }
 }
 
-auto buildTextShader() -> glFractals::Shader
+struct Options : glFractals::EngineOptions {
+    // Timing statistics in the HUD, and streamed to the file when set.
+    bool profile = false;
+    std::string profileCsv;
+    // Input log to write, or to replay instead of the live input, advancing
+    // replayStep milliseconds per frame.
+    std::string record;
+    std::string replay;
+    float replayStep = 1000.0f / 60.0f;
+    // Publishes the finished frames of the viewer to this shared memory
+    // object.
+    std::string shm;
+    // Renders to this file without a window when set.
+    std::string output;
+    // Splits the --output frame into tiles for the workers connecting to
+    // this address, or renders tiles for the coordinator at it.
+    std::string coordinator;
+    std::string worker;
+    int tileSize = 256;
+    // Serves map tiles over HTTP on this address, caching this many MiB.
+    std::string serve;
+    std::size_t cacheMiB = 256;
+    Point2D<int> size = {glFractals::Framework::DEFAULT_WIN_WIDTH,
+                         glFractals::Framework::DEFAULT_WIN_HEIGHT};
+    int frames = 1;
+    // Headless and tiled frames only. The view starts where the controller
+    // starts, except for the values given.
+    int iterations = 0;
+    bool distanceEstimation = false;
+    Point2D<double> viewCenter = {};
+    double viewHeight = 0.0;
+    bool hasSeed = false;
+    Point2D<double> seed = {};
+    std::string shaderCache = glFractals::ProgramCache::defaultDirectory();
+    glFractals::DebugSeverity debugSeverity = glFractals::DebugSeverity::OFF;
+};
+
+// Ends the program with a usage error for the value of flag.
+[[noreturn]] void badValue(const std::string& flag,
+                           const std::string& value,
+                           const char* expected)
 {
-    std::vector<glFractals::Shader::Source> sources;
-    sources.push_back({glFractals::Shader::Source::Type::VERTEX_SHADER,
-                       ROOT_PATH_STR + "/src/shaders/Text.vs"});
-    sources.push_back({glFractals::Shader::Source::Type::FRAGMENT_SHADER,
-                       ROOT_PATH_STR + "/src/shaders/Text.fs"});
+    std::cerr << flag << " expects " << expected << ", got '" << value << "'"
+              << std::endl;
+    std::exit(1);
+}
 
-    return glFractals::Shader(sources);
+// These take the value of the flag at i and step i over it. Values that
+// aren't a whole number of the type, or are out of its range, are usage
+// errors.
+auto intValue(const std::vector<std::string>& args, std::size_t& i) -> int
+{
+    const auto& value = args[++i];
+    try {
+        auto end = std::size_t(0);
+        const auto number = std::stoi(value, &end);
+        if (end == value.size()) {
+            return number;
+        }
+    }
+    catch (const std::logic_error&) {
+    }
+    badValue(args[i - 1], value, "an integer");
 }
 
-auto stateControllerFactory(FractalType fractalType, Point2D<int> resolution)
-    -> std::unique_ptr<glFractals::StateController>
+auto countValue(const std::vector<std::string>& args, std::size_t& i)
+    -> unsigned long long
 {
-    if (fractalType == FractalType::MANDELBROT) {
-        return std::make_unique<glFractals::MandelbrotController>(resolution);
+    const auto& value = args[++i];
+    // stoull would wrap negative numbers around.
+    if (value.find('-') == std::string::npos) {
+        try {
+            auto end = std::size_t(0);
+            const auto number = std::stoull(value, &end);
+            if (end == value.size()) {
+                return number;
+            }
+        }
+        catch (const std::logic_error&) {
+        }
     }
-    else {
-        return std::make_unique<glFractals::JuliaController>(resolution);
+    badValue(args[i - 1], value, "a non-negative integer");
+}
+
+auto floatValue(const std::vector<std::string>& args, std::size_t& i) -> float
+{
+    const auto& value = args[++i];
+    try {
+        auto end = std::size_t(0);
+        const auto number = std::stof(value, &end);
+        if (end == value.size()) {
+            return number;
+        }
+    }
+    catch (const std::logic_error&) {
+    }
+    badValue(args[i - 1], value, "a number");
+}
+
+auto parseOptions(const std::vector<std::string>& args) -> Options
+{
+    auto options = Options();
+    for (std::size_t i = 1; i < args.size(); i++) {
+        const auto hasValue = i + 1 < args.size();
+        if (args[i] == "julia") {
+            options.fractalType = FractalType::JULIA;
+        }
+        else if (args[i] == "buddhabrot") {
+            options.fractalType = FractalType::BUDDHABROT;
+        }
+        else if (args[i] == "--nebula" && hasValue) {
+            options.fractalType = FractalType::BUDDHABROT;
+            auto& limits = options.channelIterations;
+            if (std::sscanf(args[++i].c_str(),
+                            "%d,%d,%d",
+                            &limits[0],
+                            &limits[1],
+                            &limits[2]) != 3) {
+                std::cerr << "--nebula expects R,G,B iteration limits"
+                          << std::endl;
+            }
+        }
+        else if (args[i] == "--metropolis") {
+            options.fractalType = FractalType::BUDDHABROT;
+            options.sampling =
+                glFractals::BuddhabrotRenderer::Sampling::METROPOLIS;
+        }
+        else if (args[i] == "--samples" && hasValue) {
+            options.sampleLimit = countValue(args, i);
+        }
+        else if (args[i] == "--formula" && hasValue) {
+            options.formula = glFractals::formulaByName(args[++i]);
+        }
+        else if (args[i] == "--cpu") {
+            options.engine = Engine::CPU;
+        }
+        else if (args[i] == "--disk-fill") {
+            options.engine = Engine::CPU;
+            options.cpuMethod = glFractals::CpuRenderer::Method::DISK_FILL;
+        }
+        else if (args[i] == "--fixed-point") {
+            options.engine = Engine::CPU;
+            options.cpuArithmetic =
+                glFractals::CpuRenderer::Arithmetic::FIXED_POINT;
+        }
+        else if (args[i] == "--shader-cache" && hasValue) {
+            options.shaderCache = args[++i];
+        }
+        else if (args[i] == "--gl-debug" && hasValue) {
+            options.debugSeverity = glFractals::debugSeverityByName(args[++i]);
+        }
+        else if (args[i] == "--no-shader-cache") {
+            options.shaderCache.clear();
+        }
+        else if (args[i] == "--no-symmetry") {
+            options.symmetry = false;
+        }
+        else if (args[i] == "--output" && hasValue) {
+            options.output = args[++i];
+        }
+        else if (args[i] == "--coordinator" && hasValue) {
+            options.coordinator = args[++i];
+        }
+        else if (args[i] == "--worker" && hasValue) {
+            options.worker = args[++i];
+        }
+        else if (args[i] == "--tile-size" && hasValue) {
+            options.tileSize = intValue(args, i);
+        }
+        else if (args[i] == "--serve" && hasValue) {
+            options.serve = args[++i];
+        }
+        else if (args[i] == "--cache-mb" && hasValue) {
+            options.cacheMiB = countValue(args, i);
+        }
+        else if (args[i] == "--threads" && hasValue) {
+            const auto threads = countValue(args, i);
+            if (threads > std::numeric_limits<unsigned>::max()) {
+                badValue(args[i - 1], args[i], "a thread count");
+            }
+            options.cpuThreads = static_cast<unsigned>(threads);
+        }
+        else if (args[i] == "--size" && hasValue) {
+            if (std::sscanf(args[++i].c_str(),
+                            "%dx%d",
+                            &options.size.x,
+                            &options.size.y) != 2) {
+                std::cerr << "--size expects WIDTHxHEIGHT" << std::endl;
+            }
+        }
+        else if (args[i] == "--frames" && hasValue) {
+            options.frames = intValue(args, i);
+        }
+        else if (args[i] == "--iterations" && hasValue) {
+            options.iterations = intValue(args, i);
+        }
+        else if (args[i] == "--distance-estimate") {
+            options.distanceEstimation = true;
+        }
+        else if (args[i] == "--view" && hasValue) {
+            if (std::sscanf(args[++i].c_str(),
+                            "%lf,%lf,%lf",
+                            &options.viewCenter.x,
+                            &options.viewCenter.y,
+                            &options.viewHeight) != 3) {
+                std::cerr << "--view expects X,Y,HEIGHT" << std::endl;
+            }
+        }
+        else if (args[i] == "--seed" && hasValue) {
+            options.hasSeed = std::sscanf(args[++i].c_str(),
+                                          "%lf,%lf",
+                                          &options.seed.x,
+                                          &options.seed.y) == 2;
+            if (!options.hasSeed) {
+                std::cerr << "--seed expects X,Y" << std::endl;
+            }
+        }
+        else if (args[i] == "--profile") {
+            options.profile = true;
+        }
+        else if (args[i] == "--profile-csv" && hasValue) {
+            options.profileCsv = args[++i];
+        }
+        else if (args[i] == "--record" && hasValue) {
+            options.record = args[++i];
+        }
+        else if (args[i] == "--shm" && hasValue) {
+            options.shm = args[++i];
+        }
+        else if (args[i] == "--replay" && hasValue) {
+            options.replay = args[++i];
+        }
+        else if (args[i] == "--replay-step" && hasValue) {
+            options.replayStep = floatValue(args, i);
+        }
+        else if (args[i] == "--frame-budget" && hasValue) {
+            options.frameBudget = floatValue(args, i);
+        }
+        else if (args[i] == "--aa") {
+            options.antiAliasing.enabled = true;
+        }
+        else if (args[i] == "--aa-samples" && hasValue) {
+            options.antiAliasing.enabled = true;
+            options.antiAliasing.subsamples = intValue(args, i);
+        }
+        else if (args[i] == "--aa-threshold" && hasValue) {
+            options.antiAliasing.enabled = true;
+            options.antiAliasing.threshold = floatValue(args, i);
+        }
+        else {
+            std::cerr << "ignoring unknown option " << args[i] << std::endl;
+        }
+    }
+    return options;
+}
+
+// How often the controller is updated while no input arrives, so held keys
+// move the camera smoothly.
+static constexpr double INPUT_INTERVAL = 0.001;
+
+// Everything the render thread needs from the main thread for one frame.
+struct FrameSnapshot {
+    glFractals::FractalParams params = {};
+    // The controller's lines, the renderers add theirs.
+    glFractals::HudText hud = {};
+    bool antiAliasing = false;
+};
+
+// Render settings toggled by keys. Listeners run on the main thread, the
+// render thread picks the state up from the snapshots.
+class RenderToggles : public glFractals::KeyListener {
+public:
+    explicit RenderToggles(bool antiAliasing) : antiAliasing_(antiAliasing) {}
+
+    void notifyEvent(glFractals::Event event,
+                     glFractals::ButtonState state) override
+    {
+        if (event == glFractals::Event::TOGGLE_ANTIALIASING &&
+            state == glFractals::ButtonState::PRESSED) {
+            antiAliasing_ = !antiAliasing_;
+        }
+    }
+
+    auto antiAliasing() const -> bool { return antiAliasing_; }
+
+private:
+    bool antiAliasing_;
+};
+
+// Where frame time goes, see --profile.
+struct ProfileSections {
+    // Input thread.
+    int events = 0;
+    int update = 0;
+    // Render thread, fractal and text are GPU times.
+    int upload = 0;
+    int fractal = 0;
+    int text = 0;
+    int swap = 0;
+};
+
+auto makeProfiler(const Options& options, ProfileSections& sections)
+    -> std::unique_ptr<glFractals::Profiler>
+{
+    if (!options.profile && options.profileCsv.empty()) {
+        return nullptr;
+    }
+
+    auto profiler = std::make_unique<glFractals::Profiler>();
+    sections.events = profiler->addSection("events");
+    sections.update = profiler->addSection("update");
+    sections.upload = profiler->addSection("upload");
+    sections.fractal = profiler->addSection("fractal gpu");
+    sections.text = profiler->addSection("text gpu");
+    sections.swap = profiler->addSection("swap");
+    if (!options.profileCsv.empty()) {
+        profiler->openCsv(options.profileCsv);
+    }
+    return profiler;
+}
+
+#ifdef HAVE_SHARED_MEMORY
+// Hands the frames readback has finished reading to ring, waiting for the
+// pending ones if wait is set.
+void publishFrames(glFractals::FrameReadback& readback,
+                   glFractals::SharedFrameRing& ring,
+                   bool wait)
+{
+    auto frame = glFractals::FrameReadback::Frame();
+    while (readback.collect(frame, wait)) {
+        if (frame.mirrored) {
+            const auto symmetry = glFractals::Symmetry(frame.params);
+            ring.publish(
+                frame.params, frame.size, frame.rgba, frame.values, &symmetry);
+        }
+        else {
+            ring.publish(frame.params, frame.size, frame.rgba, frame.values);
+        }
+    }
+}
+#endif
+
+// Runs on its own thread with the GL context current and draws the newest
+// snapshot every frame until running is cleared. Input never waits on a frame
+// and frames never wait on input, except replays, which wait until the
+// snapshots they publish are taken. Profiler is null when not profiling.
+void renderLoop(glFractals::Framework& framework,
+                const Options& options,
+                glFractals::TripleBuffer<FrameSnapshot>& snapshots,
+                const std::atomic<bool>& running,
+                std::atomic<std::uint64_t>& snapshotsTaken,
+                glFractals::Profiler* profiler,
+                const ProfileSections& sections)
+{
+    framework.makeContextCurrent();
+    snapshots.update();
+    snapshotsTaken++;
+    auto resolution = snapshots.front().params.viewResolution;
+
+    {
+        auto programCache = glFractals::ProgramCache(
+            options.shaderCache, (GLADloadproc)glfwGetProcAddress);
+        glFractals::Engines engines(programCache, options, resolution);
+        auto& fractalRenderer = engines.fractalRenderer();
+
+        auto textShader = glFractals::buildTextShader(programCache);
+        for (const auto& str : programCache.stateStrings()) {
+            std::cout << str << std::endl;
+        }
+        auto textRenderer = glFractals::TextRenderer(
+            textShader,
+            ROOT_PATH_STR + "/dep/fonts/amiko/Amiko-Regular.ttf",
+            0.025,
+            resolution);
+
+        // Reused every frame, see HudText.
+        auto hud = glFractals::HudText();
+
+        // The queries cost a little, so they only run when profiling.
+        std::unique_ptr<glFractals::GpuTimer> fractalTimer;
+        std::unique_ptr<glFractals::GpuTimer> textTimer;
+        if (profiler != nullptr) {
+            fractalRenderer.setProfiler(profiler, sections.upload);
+            fractalTimer = std::make_unique<glFractals::GpuTimer>();
+            textTimer = std::make_unique<glFractals::GpuTimer>();
+        }
+
+#ifdef HAVE_SHARED_MEMORY
+        // Finished frames are read back without the HUD and published for
+        // other processes.
+        std::unique_ptr<glFractals::FrameReadback> readback;
+        std::unique_ptr<glFractals::SharedFrameRing> sharedFrames;
+        if (!options.shm.empty()) {
+            readback = std::make_unique<glFractals::FrameReadback>();
+            sharedFrames = std::make_unique<glFractals::SharedFrameRing>(
+                options.shm, resolution);
+            std::cout << "publishing frames to shared memory "
+                      << sharedFrames->name() << std::endl;
+        }
+#endif
+
+        while (running) {
+            // Without a new snapshot the last one is drawn again.
+            if (snapshots.update()) {
+                snapshotsTaken++;
+            }
+            const auto& snapshot = snapshots.front();
+
+            if (snapshot.params.viewResolution != resolution) {
+                resolution = snapshot.params.viewResolution;
+                fractalRenderer.changeResolution(resolution);
+                textRenderer.changeResolution(resolution);
+            }
+            if (snapshot.antiAliasing !=
+                fractalRenderer.antiAliasing().enabled) {
+                auto antiAliasing = fractalRenderer.antiAliasing();
+                antiAliasing.enabled = snapshot.antiAliasing;
+                fractalRenderer.setAntiAliasing(antiAliasing);
+            }
+
+            auto seconds = 0.0f;
+            if (profiler != nullptr) {
+                while (fractalTimer->collect(seconds)) {
+                    profiler->add(sections.fractal, seconds);
+                }
+                while (textTimer->collect(seconds)) {
+                    profiler->add(sections.text, seconds);
+                }
+                fractalTimer->begin();
+            }
+            engines.render(snapshot.params);
+            if (profiler != nullptr) {
+                fractalTimer->end();
+            }
+#ifdef HAVE_SHARED_MEMORY
+            if (sharedFrames) {
+                if (engines.frameFinished()) {
+                    engines.readFrame(*readback, snapshot.params);
+                }
+                publishFrames(*readback, *sharedFrames, false);
+            }
+#endif
+
+            hud.clear();
+            hud.addLines(snapshot.hud);
+            engines.stateLines(hud);
+            if (options.profile) {
+                profiler->stateLines(hud);
+            }
+#ifdef HAVE_SHARED_MEMORY
+            if (sharedFrames) {
+                hud.addLine("shm: %llu frames, %llu dropped",
+                            static_cast<unsigned long long>(
+                                sharedFrames->published()),
+                            static_cast<unsigned long long>(
+                                readback->dropped()));
+            }
+#endif
+            if (profiler != nullptr) {
+                textTimer->begin();
+            }
+            textRenderer.render(hud);
+            if (profiler != nullptr) {
+                textTimer->end();
+            }
+
+            {
+                glFractals::ScopeTimer timer(profiler, sections.swap);
+                framework.swapBuffers();
+            }
+            if (profiler != nullptr) {
+                profiler->endFrame();
+            }
+        }
+#ifdef HAVE_SHARED_MEMORY
+        if (sharedFrames) {
+            publishFrames(*readback, *sharedFrames, true);
+        }
+#endif
+    }
+
+    // The GL objects are gone, hand the context back for the window.
+    framework.releaseContext();
+}
+
+// The frame the options describe, without a window. The view starts where
+// the controller starts, except for the values given.
+auto headlessParams(const Options& options) -> glFractals::FractalParams
+{
+    auto params = stateControllerFactory(options.fractalType, options.size)
+                      ->params();
+    if (options.iterations > 0) {
+        params.iterations = options.iterations;
+    }
+    if (options.distanceEstimation) {
+        params.mode = glFractals::RenderMode::DISTANCE_ESTIMATE;
+    }
+    if (options.viewHeight > 0.0) {
+        params.compCenter = options.viewCenter;
+        params.compResolution = {options.viewHeight * options.size.x /
+                                     options.size.y,
+                                 options.viewHeight};
+    }
+    if (options.fractalType == FractalType::JULIA && options.hasSeed) {
+        params.seed = options.seed;
+    }
+    params.formula = options.formula;
+    return params;
+}
+
+#ifdef HAVE_EGL
+// Renders options.frames frames of the view the options describe without a
+// window and writes the last one to options.output.
+void renderHeadless(const Options& options)
+{
+    glFractals::HeadlessContext context(options.size.x, options.size.y);
+    if (!glFractals::enableDebugOutput(
+            glFractals::HeadlessContext::getProcAddress,
+            options.debugSeverity)) {
+        std::cerr << "--gl-debug: the driver has no KHR_debug" << std::endl;
+    }
+
+    const auto params = headlessParams(options);
+    auto programCache = glFractals::ProgramCache(
+        options.shaderCache, glFractals::HeadlessContext::getProcAddress);
+    glFractals::Engines engines(programCache, options, options.size);
+    engines.fractalRenderer().setTarget(context.framebuffer());
+    // Every frame is a finished one.
+    engines.fractalRenderer().setFrameBudget(0.0f);
+
+    for (int frame = 0; frame < options.frames; frame++) {
+        engines.render(params);
+    }
+    context.writePpm(options.output);
+
+    auto hud = glFractals::HudText();
+    engines.stateLines(hud);
+    for (std::size_t i = 0; i < hud.size(); i++) {
+        std::cout << hud.line(i) << std::endl;
     }
 }
+#endif
+
+#ifdef HAVE_SOCKETS
+// Hands the tiles of the frame the options describe to the workers that
+// connect and writes it to options.output as they come back.
+void coordinateTiles(const Options& options)
+{
+    if (options.fractalType == FractalType::BUDDHABROT) {
+        throw std::runtime_error("the Buddhabrot can't be split into tiles");
+    }
+    auto job = glFractals::TileJob();
+    job.params = headlessParams(options);
+    job.arithmetic = options.cpuArithmetic;
+    // Workers would quietly fall back to double, the frame wouldn't be the
+    // same on every machine as fixed point promises.
+    if (job.arithmetic == glFractals::CpuRenderer::Arithmetic::FIXED_POINT &&
+        !glFractals::CpuRenderer(1).fixedPointCovers(job.params)) {
+        throw std::runtime_error(
+            "--fixed-point only renders escape time views of quadratic "
+            "formulas within the escape radius, with pixels of at least 16 "
+            "fixed point steps");
+    }
+
+    glFractals::TileCoordinator coordinator(
+        options.coordinator, job, options.tileSize);
+    glFractals::TileImage image(options.output, options.size);
+    std::cout << "waiting for workers on " << options.coordinator << ", "
+              << coordinator.tileCount() << " tiles" << std::endl;
+
+    const auto start = std::chrono::steady_clock::now();
+    coordinator.run(image);
+    image.close();
+    const auto seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    const auto& stats = coordinator.stats();
+    std::printf("%zu tiles in %.2f s from %llu workers, %llu reassigned, "
+                "%llu copies\n",
+                coordinator.tileCount(),
+                seconds,
+                static_cast<unsigned long long>(stats.workers),
+                static_cast<unsigned long long>(stats.reassigned),
+                static_cast<unsigned long long>(stats.copies));
+}
+#endif
+
+#ifdef HAVE_SOCKETS
+// Serves map tiles of the fractals over HTTP until the process is killed.
+void serveTiles(const Options& options)
+{
+    auto settings = glFractals::TileServer::Settings();
+    settings.threads = options.cpuThreads;
+    if (options.iterations > 0) {
+        settings.iterations = options.iterations;
+    }
+    settings.juliaFormula = options.formula;
+    if (options.hasSeed) {
+        settings.juliaSeed = options.seed;
+    }
+    settings.arithmetic = options.cpuArithmetic;
+    settings.cacheBytes = options.cacheMiB << 20;
+
+    glFractals::TileServer server(options.serve, settings);
+    std::cout << "serving http://" << options.serve
+              << "/{fractal}/{z}/{x}/{y}.png, counters at /stats"
+              << std::endl;
+    server.run();
+}
+#endif
 
 auto main(int argc, char** argv) -> int
 {
-    auto args = std::vector<std::string>(argv, argv + argc);
-    auto fractalType = (args.size() < 2 || args[1] != "julia")
-                           ? FractalType::MANDELBROT
-                           : FractalType::JULIA;
+    const auto options =
+        parseOptions(std::vector<std::string>(argv, argv + argc));
 
-    auto framework = glFractals::Framework();
+    if (!options.coordinator.empty() || !options.worker.empty() ||
+        !options.serve.empty()) {
+#ifdef HAVE_SOCKETS
+        try {
+            if (!options.serve.empty()) {
+                serveTiles(options);
+            }
+            else if (!options.worker.empty()) {
+                const auto tiles = glFractals::runTileWorker(
+                    options.worker, options.cpuThreads);
+                std::cout << "rendered " << tiles << " tiles" << std::endl;
+            }
+            else if (options.output.empty()) {
+                std::cerr << "--coordinator needs --output" << std::endl;
+                return 1;
+            }
+            else {
+                coordinateTiles(options);
+            }
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+#else
+        std::cerr << "tile rendering and serving need sockets, which this "
+                     "platform was built without"
+                  << std::endl;
+        return 1;
+#endif
+    }
 
-    auto controller =
-        stateControllerFactory(fractalType, framework.resolution());
+    if (!options.output.empty()) {
+#ifdef HAVE_EGL
+        renderHeadless(options);
+        return 0;
+#else
+        std::cerr << "--output needs the headless backend, which was built "
+                     "without EGL"
+                  << std::endl;
+        return 1;
+#endif
+    }
 
-    auto fractalShader = buildFractalShader(fractalType);
-    auto fractalRenderer = glFractals::FractalRenderer(framework.resolution());
+#ifndef HAVE_SHARED_MEMORY
+    if (!options.shm.empty()) {
+        std::cerr << "--shm needs POSIX shared memory, which this platform "
+                     "was built without"
+                  << std::endl;
+        return 1;
+    }
+#endif
 
-    auto textShader = buildTextShader();
-    auto textRenderer = glFractals::TextRenderer(
-        textShader,
-        ROOT_PATH_STR + "/dep/fonts/amiko/Amiko-Regular.ttf",
-        0.025,
-        framework.resolution());
+    // Replays start in the window size of the recorded session.
+    std::unique_ptr<glFractals::InputReplay> replay;
+    auto winSize = Point2D<int>{glFractals::Framework::DEFAULT_WIN_WIDTH,
+                                glFractals::Framework::DEFAULT_WIN_HEIGHT};
+    if (!options.replay.empty()) {
+        replay = std::make_unique<glFractals::InputReplay>(options.replay);
+        winSize = replay->resolution();
+    }
+
+    const auto debug = options.debugSeverity != glFractals::DebugSeverity::OFF;
+    glFractals::Framework framework(winSize.x, winSize.y, debug);
+    if (!glFractals::enableDebugOutput((GLADloadproc)glfwGetProcAddress,
+                                       options.debugSeverity)) {
+        std::cerr << "--gl-debug: the driver has no KHR_debug" << std::endl;
+    }
+
+    auto controller =
+        stateControllerFactory(options.fractalType, framework.resolution());
+    auto toggles = RenderToggles(options.antiAliasing.enabled);
 
     framework.mapButton(GLFW_KEY_ESCAPE, glFractals::Event::EXIT);
     framework.mapButton(GLFW_KEY_W, glFractals::Event::MOVE_UP);
@@ -84,31 +764,124 @@ auto main(int argc, char** argv) -> int
     framework.mapButton(GLFW_KEY_E, glFractals::Event::INCREASE_ITERATIONS);
     framework.mapButton(GLFW_KEY_Q, glFractals::Event::DECREASE_ITERATIONS);
     framework.mapButton(GLFW_KEY_SPACE, glFractals::Event::RESET_CAMERA);
+    framework.mapButton(GLFW_KEY_F, glFractals::Event::TOGGLE_ANTIALIASING);
+    framework.mapButton(GLFW_KEY_G,
+                        glFractals::Event::TOGGLE_DISTANCE_ESTIMATION);
     framework.mapMouseButton(GLFW_MOUSE_BUTTON_1,
                              glFractals::Event::DRAG_CAMERA);
     framework.mapMouseButton(GLFW_MOUSE_BUTTON_2, glFractals::Event::DRAG_SEED);
 
     framework.registerCloseListener(*controller);
     framework.registerKeyListener(*controller);
+    framework.registerKeyListener(toggles);
     framework.registerMouseListener(*controller);
     framework.registerResolutionChangeListener(*controller);
-    framework.registerResolutionChangeListener(fractalRenderer);
-    framework.registerResolutionChangeListener(textRenderer);
 
-    auto prevFrame = framework.time();
-    while (!controller->shouldClose()) {
-        auto curFrame = framework.time();
-        auto delta = curFrame - prevFrame;
-        prevFrame = curFrame;
+    glFractals::TripleBuffer<FrameSnapshot> snapshots;
+    std::uint64_t published = 0;
+    const auto publish = [&]() {
+        auto& snapshot = snapshots.back();
+        snapshot.params = controller->params();
+        snapshot.hud.clear();
+        controller->stateLines(snapshot.hud);
+        snapshot.antiAliasing = toggles.antiAliasing();
+        snapshots.publish();
+        published++;
+    };
+    publish();
+
+    auto sections = ProfileSections();
+    const auto profiler = makeProfiler(options, sections);
 
-        controller->update(delta);
+    // The controller moves by the time between updates.
+    auto prevUpdate = replay ? replay->startTime() : framework.time();
+    std::unique_ptr<glFractals::InputRecorder> recorder;
+    if (!options.record.empty()) {
+        recorder = std::make_unique<glFractals::InputRecorder>(
+            options.record, framework.resolution(), prevUpdate);
+        framework.recordEvents(recorder.get());
+    }
+    const auto update = [&](float curUpdate) {
+        glFractals::ScopeTimer timer(profiler.get(), sections.update);
+        if (recorder) {
+            recorder->writeUpdate(curUpdate);
+        }
+        controller->update(curUpdate - prevUpdate);
+        prevUpdate = curUpdate;
+    };
+
+    // Rendering gets the context and its own thread, this one keeps handling
+    // input.
+    std::atomic<bool> running(true);
+    std::atomic<bool> renderDone(false);
+    std::atomic<std::uint64_t> snapshotsTaken(0);
+    auto renderError = std::exception_ptr();
+    framework.releaseContext();
+    auto renderThread = std::thread([&]() {
+        try {
+            renderLoop(framework,
+                       options,
+                       snapshots,
+                       running,
+                       snapshotsTaken,
+                       profiler.get(),
+                       sections);
+        }
+        catch (...) {
+            renderError = std::current_exception();
+        }
+        renderDone = true;
+    });
+
+    // Replays show the recorded session every replayStep seconds, however long
+    // the frames take. Each frame runs the updates the session made during its
+    // step with the events in between, so the controller goes through the
+    // same states and every run draws the same frames.
+    const auto replayStep = options.replayStep * 1e-3f;
+    auto replayTime = prevUpdate;
+    while (!controller->shouldClose() && !renderDone) {
+        // Returns as soon as there is input.
+        framework.waitEvents(replay ? 0.0 : INPUT_INTERVAL);
 
-        fractalRenderer.render(fractalShader, *controller);
-        textRenderer.render(controller->stateStrings());
+        if (replay) {
+            replayTime += replayStep;
+            for (;;) {
+                {
+                    glFractals::ScopeTimer timer(profiler.get(),
+                                                 sections.events);
+                    framework.replayEvents(*replay, replayTime);
+                }
+                auto updateTime = 0.0f;
+                if (!replay->nextUpdate(replayTime, updateTime)) {
+                    break;
+                }
+                update(updateTime);
+            }
+        }
+        else {
+            {
+                glFractals::ScopeTimer timer(profiler.get(), sections.events);
+                framework.dispatchEvents();
+            }
+            update(framework.time());
+        }
+        publish();
 
-        framework.swapBuffers();
-        framework.updateEvents();
+        if (replay) {
+            while (snapshotsTaken < published && !renderDone) {
+                std::this_thread::yield();
+            }
+            if (replay->finished()) {
+                break;
+            }
+        }
+    }
+
+    running = false;
+    renderThread.join();
+    if (renderError) {
+        std::rethrow_exception(renderError);
     }
 
     return 0;
-}
\ No newline at end of file
+}
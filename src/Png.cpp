@@ -0,0 +1,128 @@
+#include "Png.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+
+namespace glFractals {
+
+static constexpr unsigned char SIGNATURE[8] = {
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+// The most bytes one uncompressed deflate block holds.
+static constexpr std::size_t MAX_STORED_BLOCK = 65535;
+
+static auto crcTable() -> const std::array<std::uint32_t, 256>&
+{
+    static const auto table = []() {
+        auto t = std::array<std::uint32_t, 256>();
+        for (std::uint32_t n = 0; n < 256; n++) {
+            auto c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+static auto crc32(const unsigned char* data, std::size_t size)
+    -> std::uint32_t
+{
+    const auto& table = crcTable();
+    auto c = 0xffffffffu;
+    for (std::size_t i = 0; i < size; i++) {
+        c = table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffffu;
+}
+
+static auto adler32(const std::vector<unsigned char>& data) -> std::uint32_t
+{
+    static constexpr std::uint32_t MOD = 65521;
+    // The most bytes the sums can take before b could overflow.
+    static constexpr std::size_t RUN = 5552;
+    std::uint32_t a = 1;
+    std::uint32_t b = 0;
+    for (std::size_t pos = 0; pos < data.size(); pos += RUN) {
+        const auto end = std::min(data.size(), pos + RUN);
+        for (auto i = pos; i < end; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= MOD;
+        b %= MOD;
+    }
+    return (b << 16) | a;
+}
+
+// PNG stores its integers big endian.
+static void putU32Be(std::vector<unsigned char>& out, std::uint32_t value)
+{
+    for (int i = 3; i >= 0; i--) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+static void putChunk(std::vector<unsigned char>& out,
+                     const char* type,
+                     const std::vector<unsigned char>& data)
+{
+    putU32Be(out, static_cast<std::uint32_t>(data.size()));
+    const auto start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putU32Be(out, crc32(out.data() + start, out.size() - start));
+}
+
+auto encodePng(int width, int height, const std::vector<unsigned char>& rgb)
+    -> std::vector<unsigned char>
+{
+    const auto rowSize = 3 * static_cast<std::size_t>(width);
+    if (width <= 0 || height <= 0 || rgb.size() != rowSize * height) {
+        throw std::runtime_error("encodePng: pixels don't match the size");
+    }
+
+    std::vector<unsigned char> header;
+    putU32Be(header, static_cast<std::uint32_t>(width));
+    putU32Be(header, static_cast<std::uint32_t>(height));
+    // 8 bits per channel, RGB, then the only compression, filter and
+    // interlace methods there are.
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+
+    // Every row starts with its filter, none.
+    std::vector<unsigned char> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        const auto row = rgb.begin() + y * rowSize;
+        raw.insert(raw.end(), row, row + rowSize);
+    }
+
+    // A zlib stream of stored blocks: a header with the smallest window and
+    // no dictionary, the blocks, then the Adler-32 of the raw data.
+    std::vector<unsigned char> zlib = {0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / MAX_STORED_BLOCK * 5 + 16);
+    for (std::size_t pos = 0; pos < raw.size(); pos += MAX_STORED_BLOCK) {
+        const auto size = std::min(MAX_STORED_BLOCK, raw.size() - pos);
+        const auto last = pos + size == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<unsigned char>(size));
+        zlib.push_back(static_cast<unsigned char>(size >> 8));
+        zlib.push_back(static_cast<unsigned char>(~size));
+        zlib.push_back(static_cast<unsigned char>(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + size);
+    }
+    putU32Be(zlib, adler32(raw));
+
+    std::vector<unsigned char> png(std::begin(SIGNATURE), std::end(SIGNATURE));
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", {});
+    return png;
+}
+
+} // namespace glFractals
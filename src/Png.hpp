@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+
+namespace glFractals {
+
+// Encodes 8 bit RGB pixels, rows top down, as a PNG. The image data goes
+// into uncompressed deflate blocks, which costs size but no time, and
+// needs no library.
+auto encodePng(int width, int height, const std::vector<unsigned char>& rgb)
+    -> std::vector<unsigned char>;
+
+} // namespace glFractals
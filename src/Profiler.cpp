@@ -0,0 +1,97 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace glFractals {
+
+constexpr std::size_t Profiler::WINDOW;
+
+auto Profiler::addSection(const std::string& name) -> int
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    sections_.emplace_back();
+    sections_.back().name = name;
+    return static_cast<int>(sections_.size()) - 1;
+}
+
+void Profiler::add(int section, float seconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& s = sections_[section];
+    s.samples[s.next] = seconds;
+    s.next = (s.next + 1) % WINDOW;
+    s.count = std::min(s.count + 1, WINDOW);
+    s.rowSum += seconds;
+    s.rowCount++;
+}
+
+void Profiler::openCsv(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    csv_.open(path, std::ios::trunc);
+    if (!csv_) {
+        throw std::runtime_error("failed to open " + path);
+    }
+
+    csv_ << "frame,time";
+    for (const auto& s : sections_) {
+        csv_ << "," << s.name;
+    }
+    csv_ << "\n";
+}
+
+void Profiler::endFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    frame_++;
+    if (!csv_.is_open()) {
+        return;
+    }
+
+    const auto time = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_);
+    csv_ << frame_ << "," << time.count();
+    for (auto& s : sections_) {
+        // Sections without samples in this frame stay empty.
+        csv_ << ",";
+        if (s.rowCount > 0) {
+            csv_ << s.rowSum / s.rowCount * 1e3;
+        }
+        s.rowSum = 0.0;
+        s.rowCount = 0;
+    }
+    csv_ << "\n";
+}
+
+void Profiler::stateLines(HudText& hud) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& s : sections_) {
+        if (s.count == 0) {
+            continue;
+        }
+
+        sorted_.assign(s.samples.begin(), s.samples.begin() + s.count);
+        auto sum = 0.0;
+        for (auto sample : sorted_) {
+            sum += sample;
+        }
+        const auto percentile = [&](float p) {
+            const auto n = static_cast<std::size_t>(p * (sorted_.size() - 1));
+            std::nth_element(
+                sorted_.begin(), sorted_.begin() + n, sorted_.end());
+            return sorted_[n];
+        };
+        const auto p95 = percentile(0.95f);
+        const auto p99 = percentile(0.99f);
+
+        hud.addLine("%s: %.2f ms, p95 %.2f, p99 %.2f",
+                    s.name.c_str(),
+                    sum / sorted_.size() * 1e3,
+                    p95 * 1e3,
+                    p99 * 1e3);
+    }
+}
+
+} // namespace glFractals
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "HudText.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// Rolling timing statistics of named sections, shown in the HUD and
+// optionally streamed to a CSV file. Any thread may add samples.
+class Profiler {
+public:
+    // Statistics cover this many of the latest samples of a section.
+    static constexpr std::size_t WINDOW = 240;
+
+    // Add every section before samples arrive from other threads. Returns
+    // the id to add samples with.
+    auto addSection(const std::string& name) -> int;
+
+    void add(int section, float seconds);
+
+    // Starts streaming to path, one row per frame. Throws
+    // std::runtime_error when the file can't be opened.
+    void openCsv(const std::string& path);
+    // Writes the CSV row of the finished frame, holding the mean of every
+    // section's samples since the previous row in milliseconds.
+    void endFrame();
+
+    // Adds the mean, 95th and 99th percentile of every section.
+    void stateLines(HudText& hud) const;
+
+private:
+    struct Section {
+        std::string name;
+        // The latest WINDOW samples, next is where the one after goes.
+        std::array<float, WINDOW> samples = {};
+        std::size_t count = 0;
+        std::size_t next = 0;
+        // Since the last CSV row.
+        double rowSum = 0.0;
+        int rowCount = 0;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Section> sections_;
+    std::ofstream csv_;
+    std::uint64_t frame_ = 0;
+    std::chrono::steady_clock::time_point start_ =
+        std::chrono::steady_clock::now();
+    // Reused for the percentiles.
+    mutable std::vector<float> sorted_;
+};
+
+// Adds the time until it goes out of scope to a section. Does nothing without
+// a profiler.
+class ScopeTimer {
+public:
+    ScopeTimer(Profiler* profiler, int section)
+        : profiler_(profiler), section_(section)
+    {
+        if (profiler_ != nullptr) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopeTimer()
+    {
+        if (profiler_ != nullptr) {
+            const auto elapsed = std::chrono::duration<float>(
+                std::chrono::steady_clock::now() - start_);
+            profiler_->add(section_, elapsed.count());
+        }
+    }
+
+    ScopeTimer(const ScopeTimer&) = delete;
+    ScopeTimer& operator=(const ScopeTimer&) = delete;
+
+private:
+    Profiler* profiler_;
+    int section_;
+    std::chrono::steady_clock::time_point start_ = {};
+};
+
+} // namespace glFractals
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace glFractals {
+
+// Fixed capacity queue between one producer thread and one consumer thread.
+// Neither side locks or allocates, push fails instead when the ring is full.
+template <typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    // Producer only.
+    auto push(const T& value) -> bool
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items_[head & INDEX_MASK] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false when the ring is empty.
+    auto pop(T& value) -> bool
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = items_[tail & INDEX_MASK];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. The oldest value, valid until the next pop.
+    auto peek() const -> const T*
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &items_[tail & INDEX_MASK];
+    }
+
+private:
+    static constexpr std::size_t INDEX_MASK = Capacity - 1;
+
+    std::array<T, Capacity> items_ = {};
+    // Both only ever grow, the difference is the number of queued values.
+    // Cache line aligned so the threads don't share lines.
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+} // namespace glFractals
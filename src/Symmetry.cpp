@@ -0,0 +1,168 @@
+#include "Symmetry.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace glFractals {
+
+Symmetry::Symmetry(const FractalParams& params, bool enabled)
+    : resolution_(params.viewResolution), compCenter_(params.compCenter)
+{
+    const auto w = resolution_.x;
+    const auto h = resolution_.y;
+    auto type = Type::NONE;
+    if (params.type == FractalType::JULIA) {
+        type = params.formula.pointSymmetric() ? Type::POINT : Type::NONE;
+    }
+    else {
+        type = params.formula.realAxisSymmetric() ? Type::REAL_AXIS
+                                                  : Type::NONE;
+    }
+
+    // Twice the center in pixels. Mirror images are out of the frame when the
+    // axis or point is further than a frame away, which also keeps it in int
+    // range.
+    const auto twiceX = std::round(2.0 * compCenter_.x * w /
+                                   params.compResolution.x);
+    const auto twiceY = std::round(2.0 * compCenter_.y * h /
+                                   params.compResolution.y);
+    const auto inRange =
+        std::abs(twiceY) < 4.0 * h &&
+        (type == Type::REAL_AXIS || std::abs(twiceX) < 4.0 * w);
+
+    if (enabled && type != Type::NONE && w > 0 && h > 0 && inRange) {
+        offset_ = {w - 1 - static_cast<int>(twiceX),
+                   h - 1 - static_cast<int>(twiceY)};
+
+        // Rows whose mirror image is below them and inside the frame.
+        const auto offY = offset_.y;
+        auto bandY0 = h;
+        auto bandY1 = h - 1;
+        if (offY >= 0) {
+            bandY0 = std::max(offY / 2 + 1, offY - h + 1);
+            bandY1 = std::min(offY, h - 1);
+        }
+        const auto bandRows = std::max(0, bandY1 - bandY0 + 1);
+
+        if (type == Type::REAL_AXIS) {
+            copiedPixels_ = static_cast<long long>(bandRows) * w;
+            addRect(0, 0, w - 1, std::min(bandY0, h) - 1);
+            addRect(0, bandY1 + 1, w - 1, h - 1);
+        }
+        else {
+            // Columns whose mirror image is inside the frame.
+            const auto offX = offset_.x;
+            const auto colX0 = std::max(0, offX - w + 1);
+            const auto colX1 = std::min(w - 1, offX);
+            const auto cols = std::max(0, colX1 - colX0 + 1);
+
+            // The row mirroring onto itself only copies its right half.
+            auto mid = -1;
+            auto midX0 = 0;
+            auto midX1 = -1;
+            if (offY >= 0 && offY % 2 == 0 && offY / 2 < h) {
+                mid = offY / 2;
+                midX0 = std::max(colX0, (offX >= 0) ? offX / 2 + 1 : w);
+                midX1 = colX1;
+            }
+            const auto midCols = std::max(0, midX1 - midX0 + 1);
+
+            copiedPixels_ =
+                static_cast<long long>(bandRows) * cols + midCols;
+            if (copiedPixels_ > 0) {
+                const auto top = (bandRows > 0) ? bandY0 - 1 : h - 1;
+                if (mid >= 0) {
+                    addRect(0, 0, w - 1, mid - 1);
+                    addRect(0, mid, midX0 - 1, mid);
+                    addRect(std::max(midX1, midX0 - 1) + 1, mid, w - 1, mid);
+                    addRect(0, mid + 1, w - 1, top);
+                }
+                else {
+                    addRect(0, 0, w - 1, top);
+                }
+                if (bandRows > 0) {
+                    addRect(0, bandY0, colX0 - 1, bandY1);
+                    addRect(colX1 + 1, bandY0, w - 1, bandY1);
+                    addRect(0, bandY1 + 1, w - 1, h - 1);
+                }
+            }
+        }
+
+        if (copiedPixels_ > 0) {
+            type_ = type;
+            // Snap to the multiple of half a pixel the offset was built from.
+            compCenter_.y = twiceY * params.compResolution.y / (2.0 * h);
+            if (type_ == Type::POINT) {
+                compCenter_.x = twiceX * params.compResolution.x / (2.0 * w);
+            }
+        }
+    }
+
+    if (type_ == Type::NONE) {
+        copiedPixels_ = 0;
+        uniqueRects_.clear();
+        addRect(0, 0, w - 1, h - 1);
+    }
+}
+
+void Symmetry::addRect(int x0, int y0, int x1, int y1)
+{
+    if (x0 <= x1 && y0 <= y1) {
+        uniqueRects_.push_back({x0, y0, x1, y1});
+    }
+}
+
+auto Symmetry::type() const -> Type { return type_; }
+
+auto Symmetry::compCenter() const -> Point2D<double> { return compCenter_; }
+
+auto Symmetry::offset() const -> Point2D<int> { return offset_; }
+
+auto Symmetry::source(int x, int y) const -> Point2D<int>
+{
+    switch (type_) {
+        case Type::REAL_AXIS:
+            return {x, offset_.y - y};
+        case Type::POINT:
+            return {offset_.x - x, offset_.y - y};
+        default:
+            return {x, y};
+    }
+}
+
+auto Symmetry::isCopy(int x, int y) const -> bool
+{
+    if (type_ == Type::NONE) {
+        return false;
+    }
+    // Keep in sync with Symmetry.fs.
+    const auto q = source(x, y);
+    const auto inFrame =
+        q.x >= 0 && q.y >= 0 && q.x < resolution_.x && q.y < resolution_.y;
+    return inFrame && (y > q.y || (y == q.y && x > q.x));
+}
+
+auto Symmetry::uniqueRects() const -> const std::vector<PixelRect>&
+{
+    return uniqueRects_;
+}
+
+auto Symmetry::copiedPixels() const -> long long { return copiedPixels_; }
+
+void Symmetry::mirror(float* values) const
+{
+    if (type_ == Type::NONE) {
+        return;
+    }
+    const auto w = static_cast<std::size_t>(resolution_.x);
+    for (int y = 0; y < resolution_.y; y++) {
+        for (int x = 0; x < resolution_.x; x++) {
+            if (isCopy(x, y)) {
+                const auto q = source(x, y);
+                values[y * w + x] = values[q.y * w + q.x];
+            }
+        }
+    }
+}
+
+} // namespace glFractals
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Common.hpp"
+#include "FractalParams.hpp"
+
+#include <vector>
+
+namespace glFractals {
+
+// Inclusive pixel rectangle, rows bottom up like OpenGL.
+struct PixelRect {
+    int x0, y0, x1, y1;
+};
+
+// How a frame maps onto itself under the symmetry of the fractal. The
+// Mandelbrot set is symmetric about the real axis and quadratic Julia sets are
+// symmetric under z -> -z, so engines only need to compute the pixels that
+// aren't mirror copies of other pixels. Whether other formulas are comes from
+// Formula.
+class Symmetry {
+public:
+    // Values are shared with Symmetry.fs.
+    enum class Type { NONE = 0, REAL_AXIS = 1, POINT = 2 };
+
+    // Type is NONE when disabled, when the formula lacks the symmetry or when
+    // no pixel of the frame has a mirror image inside the frame.
+    explicit Symmetry(const FractalParams& params, bool enabled = true);
+
+    auto type() const -> Type;
+
+    // Pixel centers only mirror onto pixel centers when twice the center is a
+    // multiple of the pixel size. This is the center moved by at most a
+    // quarter pixel to make that so. Render the frame with it.
+    auto compCenter() const -> Point2D<double>;
+
+    // The mirror image of pixel (x, y) is (offset.x - x, offset.y - y) for
+    // POINT and (x, offset.y - y) for REAL_AXIS.
+    auto offset() const -> Point2D<int>;
+
+    // True when (x, y) is the copy of its mirror image, which has to be
+    // computed instead.
+    auto isCopy(int x, int y) const -> bool;
+    auto source(int x, int y) const -> Point2D<int>;
+
+    // Rectangles covering exactly the pixels that are not copies.
+    auto uniqueRects() const -> const std::vector<PixelRect>&;
+    auto copiedPixels() const -> long long;
+
+    // Fills every copy in values (one per pixel, rows bottom up) from its
+    // mirror image.
+    void mirror(float* values) const;
+
+private:
+    Type type_ = Type::NONE;
+    Point2D<int> resolution_ = {};
+    Point2D<double> compCenter_ = {};
+    Point2D<int> offset_ = {};
+    std::vector<PixelRect> uniqueRects_;
+    long long copiedPixels_ = 0;
+
+    void addRect(int x0, int y0, int x1, int y1);
+};
+
+} // namespace glFractals
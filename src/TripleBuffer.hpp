@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace glFractals {
+
+// Hands the newest value from one writer thread to one reader thread without
+// locks, and without either side ever waiting on the other. The writer fills
+// back() and publishes it, the reader picks up the newest published value with
+// update(). Values published in between are skipped.
+template <typename T>
+class TripleBuffer {
+public:
+    // Only the writer may touch this slot, until publish.
+    auto back() -> T& { return slots_[back_].value; }
+
+    // Makes back() the newest value and hands the writer a free slot. The
+    // slot still holds an older value, so its storage gets reused.
+    void publish()
+    {
+        back_ = middle_.exchange(back_ | FRESH_BIT, std::memory_order_acq_rel) &
+                INDEX_MASK;
+    }
+
+    // Moves the newest published value to front(). Returns false, keeping
+    // front(), when nothing was published since the last update.
+    auto update() -> bool
+    {
+        if ((middle_.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+            return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) &
+                 INDEX_MASK;
+        return true;
+    }
+
+    // Only the reader may touch this slot.
+    auto front() const -> const T& { return slots_[front_].value; }
+
+private:
+    static constexpr int INDEX_MASK = 3;
+    // Set in middle_ while it holds a value the reader hasn't taken yet.
+    static constexpr int FRESH_BIT = 4;
+
+    // Cache line aligned so the threads don't share lines.
+    struct alignas(64) Slot {
+        T value = {};
+    };
+    std::array<Slot, 3> slots_;
+
+    // The slot between the threads, swapped with back_ or front_ atomically.
+    alignas(64) std::atomic<int> middle_{1};
+    alignas(64) int back_ = 0;
+    alignas(64) int front_ = 2;
+};
+
+} // namespace glFractals
@@ -0,0 +1,317 @@
+// Renders fixed camera paths headless with every engine and prints the
+// throughput as JSON, so changes to the renderers can be compared by numbers.
+//
+//   glFractals_bench [--size WxH] [--frames N] [--threads N] [--output FILE]
+
+#include "Common.hpp"
+#include "CpuRenderer.hpp"
+#include "Engines.hpp"
+#include "FractalParams.hpp"
+#include "HeadlessContext.hpp"
+#include "ProgramCache.hpp"
+#include "gl_utils.h"
+
+#include "glad/glad.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using glFractals::FractalType;
+
+namespace {
+
+// One camera of a path.
+struct CameraState {
+    Point2D<double> center;
+    // Of the complex plane shown, the width follows the aspect ratio.
+    double height;
+    int iterations;
+};
+
+// Moves from start to end over the frames. The height shrinks geometrically
+// so the zoom speed is constant, the center and iterations move linearly.
+struct CameraPath {
+    std::string name;
+    FractalType type;
+    CameraState start;
+    CameraState end;
+    // Only used by Julia paths.
+    Point2D<double> seed;
+};
+
+// The shaders compute in single precision, which runs out at heights around
+// 1e-4 over a few hundred pixels, so deep paths stop there.
+const std::vector<CameraPath> PATHS = {
+    {"mandelbrot-shallow",
+     FractalType::MANDELBROT,
+     {{-0.5, 0.0}, 2.5, 200},
+     {{-0.743643887, 0.131825904}, 0.1, 200},
+     {}},
+    {"mandelbrot-medium",
+     FractalType::MANDELBROT,
+     {{-0.743643887, 0.131825904}, 1e-2, 800},
+     {{-0.743643887, 0.131825904}, 1e-3, 800},
+     {}},
+    {"mandelbrot-deep",
+     FractalType::MANDELBROT,
+     {{-0.743643887, 0.131825904}, 1e-3, 2000},
+     {{-0.743643887, 0.131825904}, 1e-4, 2000},
+     {}},
+    {"julia-shallow",
+     FractalType::JULIA,
+     {{0.0, 0.0}, 3.0, 200},
+     {{0.1449684, -0.7425548}, 1.0, 200},
+     {-0.8, 0.156}},
+    {"julia-medium",
+     FractalType::JULIA,
+     {{0.1449684, -0.7425548}, 1e-1, 800},
+     {{0.1449684, -0.7425548}, 1e-2, 800},
+     {-0.8, 0.156}},
+    {"julia-deep",
+     FractalType::JULIA,
+     {{0.1449684, -0.7425548}, 1e-3, 2000},
+     {{0.1449684, -0.7425548}, 1e-4, 2000},
+     {-0.8, 0.156}},
+};
+
+struct BenchOptions {
+    Point2D<int> size = {320, 180};
+    int frames = 24;
+    // 0 uses every hardware thread.
+    unsigned threads = 0;
+    // Prints to stdout when empty.
+    std::string output;
+};
+
+// What one engine spent on one path.
+struct Result {
+    std::string path;
+    std::string fractal;
+    std::string engine;
+    int frames = 0;
+    double seconds = 0.0;
+    double pixels = 0.0;
+    double iterations = 0.0;
+};
+
+auto parseOptions(const std::vector<std::string>& args) -> BenchOptions
+{
+    auto options = BenchOptions();
+    for (std::size_t i = 1; i < args.size(); i++) {
+        const auto hasValue = i + 1 < args.size();
+        if (args[i] == "--size" && hasValue) {
+            if (std::sscanf(args[++i].c_str(),
+                            "%dx%d",
+                            &options.size.x,
+                            &options.size.y) != 2) {
+                std::cerr << "--size expects WIDTHxHEIGHT" << std::endl;
+            }
+        }
+        else if (args[i] == "--frames" && hasValue) {
+            options.frames = std::max(1, std::stoi(args[++i]));
+        }
+        else if (args[i] == "--threads" && hasValue) {
+            options.threads = static_cast<unsigned>(std::stoul(args[++i]));
+        }
+        else if (args[i] == "--output" && hasValue) {
+            options.output = args[++i];
+        }
+        else {
+            std::cerr << "unknown option " << args[i] << std::endl;
+        }
+    }
+    return options;
+}
+
+auto frameParams(const CameraPath& path,
+                 Point2D<int> size,
+                 int frame,
+                 int frames) -> glFractals::FractalParams
+{
+    const auto t = frames > 1 ? double(frame) / (frames - 1) : 0.0;
+    const auto& a = path.start;
+    const auto& b = path.end;
+
+    auto params = glFractals::FractalParams();
+    params.type = path.type;
+    params.iterations = static_cast<int>(
+        std::lround(a.iterations + t * (b.iterations - a.iterations)));
+    params.viewResolution = size;
+    params.compCenter = {a.center.x + t * (b.center.x - a.center.x),
+                         a.center.y + t * (b.center.y - a.center.y)};
+    const auto height = a.height * std::pow(b.height / a.height, t);
+    params.compResolution = {height * size.x / size.y, height};
+    params.seed = path.seed;
+    return params;
+}
+
+// The iterations behind a frame of escape time values, which are the escape
+// iteration over the limit and 1 inside the set.
+auto countIterations(const std::vector<float>& values, int iterations)
+    -> double
+{
+    double sum = 0.0;
+    for (const auto v : values) {
+        sum += v;
+    }
+    return std::round(sum * iterations);
+}
+
+// Renders the first frame untimed to warm up the caches and the driver, then
+// times the whole path. The first engine fills in the iterations per frame.
+auto runPath(glFractals::ProgramCache& programCache,
+             const glFractals::HeadlessContext& context,
+             const glFractals::EngineOptions& engineOptions,
+             const CameraPath& path,
+             const BenchOptions& options,
+             std::vector<double>& frameIterations) -> Result
+{
+    glFractals::Engines engines(programCache, engineOptions, options.size);
+    engines.fractalRenderer().setTarget(context.framebuffer());
+
+    const auto counting = frameIterations.empty();
+    engines.render(frameParams(path, options.size, 0, options.frames));
+    GL(glFinish());
+
+    auto result = Result();
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < options.frames; frame++) {
+        const auto params =
+            frameParams(path, options.size, frame, options.frames);
+        engines.render(params);
+        if (counting) {
+            frameIterations.push_back(
+                countIterations(engines.cpuValues(), params.iterations));
+        }
+    }
+    GL(glFinish());
+    result.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    result.path = path.name;
+    result.fractal = path.type == FractalType::JULIA ? "julia" : "mandelbrot";
+    result.frames = options.frames;
+    result.pixels = double(options.size.x) * options.size.y * options.frames;
+    for (const auto iterations : frameIterations) {
+        result.iterations += iterations;
+    }
+    return result;
+}
+
+void writeJson(std::ostream& out,
+               const BenchOptions& options,
+               const std::vector<Result>& results)
+{
+    out << "{\n";
+    out << "  \"width\": " << options.size.x << ",\n";
+    out << "  \"height\": " << options.size.y << ",\n";
+    out << "  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"path\": \"" << r.path << "\", \"fractal\": \""
+            << r.fractal << "\", \"engine\": \"" << r.engine
+            << "\", \"frames\": " << r.frames
+            << ", \"seconds\": " << r.seconds
+            << ", \"frames_per_second\": " << r.frames / r.seconds
+            << ", \"mpixels_per_second\": " << r.pixels / r.seconds * 1e-6
+            << ", \"iterations_per_second\": " << r.iterations / r.seconds
+            << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    try {
+        const auto options =
+            parseOptions(std::vector<std::string>(argv, argv + argc));
+
+        glFractals::HeadlessContext context(options.size.x, options.size.y);
+        // No disk cache, so every run compiles the same way.
+        auto programCache = glFractals::ProgramCache(
+            "", glFractals::HeadlessContext::getProcAddress);
+
+        struct EngineRun {
+            const char* name;
+            glFractals::Engine engine;
+            glFractals::CpuRenderer::Method method;
+            glFractals::CpuRenderer::Arithmetic arithmetic;
+        };
+        // The per pixel CPU engine goes first, its values count the
+        // iterations of every frame for the others.
+        const EngineRun engineRuns[] = {
+            {"cpu",
+             glFractals::Engine::CPU,
+             glFractals::CpuRenderer::Method::PER_PIXEL,
+             glFractals::CpuRenderer::Arithmetic::DOUBLE},
+            {"cpu-disk-fill",
+             glFractals::Engine::CPU,
+             glFractals::CpuRenderer::Method::DISK_FILL,
+             glFractals::CpuRenderer::Arithmetic::DOUBLE},
+            {"cpu-fixed-point",
+             glFractals::Engine::CPU,
+             glFractals::CpuRenderer::Method::PER_PIXEL,
+             glFractals::CpuRenderer::Arithmetic::FIXED_POINT},
+            {"glsl",
+             glFractals::Engine::GLSL,
+             glFractals::CpuRenderer::Method::PER_PIXEL,
+             glFractals::CpuRenderer::Arithmetic::DOUBLE},
+        };
+
+        std::vector<Result> results;
+        for (const auto& path : PATHS) {
+            std::vector<double> frameIterations;
+            for (const auto& run : engineRuns) {
+                auto engineOptions = glFractals::EngineOptions();
+                engineOptions.fractalType = path.type;
+                engineOptions.engine = run.engine;
+                engineOptions.cpuMethod = run.method;
+                engineOptions.cpuArithmetic = run.arithmetic;
+                engineOptions.cpuThreads = options.threads;
+                // Every frame is a finished one.
+                engineOptions.frameBudget = 0.0f;
+
+                std::cerr << path.name << " " << run.name << "..."
+                          << std::flush;
+                auto result = runPath(programCache,
+                                      context,
+                                      engineOptions,
+                                      path,
+                                      options,
+                                      frameIterations);
+                result.engine = run.name;
+                std::cerr << " " << result.frames / result.seconds
+                          << " frames/s" << std::endl;
+                results.push_back(result);
+            }
+        }
+
+        if (options.output.empty()) {
+            writeJson(std::cout, options, results);
+        }
+        else {
+            std::ofstream out(options.output, std::ios::trunc);
+            if (!out) {
+                throw std::runtime_error("failed to open " + options.output);
+            }
+            writeJson(out, options, results);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,406 @@
+// Times the per pixel iteration loop of the CPU engines on fixed point sets
+// and prints nanoseconds per iteration as JSON, so changes to the kernels can
+// be measured without the rest of a frame.
+//
+//   glFractals_kernel_bench [--iterations N] [--points N] [--warmup N]
+//                           [--repetitions N] [--output FILE]
+
+#include "FixedPoint.hpp"
+#include "Kernels.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using glFractals::Escape;
+using glFractals::escape;
+
+namespace {
+
+// Repetitions run the point set as often as it takes to fill at least this
+// many seconds, so short sets are still timed well above the clock
+// resolution.
+constexpr double MIN_REPETITION_SECONDS = 0.01;
+// Points escaping before this many iterations make up the exterior set.
+constexpr int EXTERIOR_ITERATIONS = 16;
+// Gives up on a point set after this many candidates per point.
+constexpr int MAX_ATTEMPTS = 10000;
+
+struct Point {
+    double x;
+    double y;
+};
+
+enum class Fractal { MANDELBROT, JULIA };
+
+// Interior points never escape and exterior points escape right away, so they
+// time the loop without and with the escape. Boundary points escape late and
+// at scattered iterations, like the pixels that dominate deep zooms.
+enum class PointSet { INTERIOR, EXTERIOR, BOUNDARY };
+
+const Point JULIA_SEED = {-0.8, 0.156};
+
+struct BenchOptions {
+    int iterations = 1000;
+    int points = 256;
+    int warmup = 2;
+    int repetitions = 10;
+    // Prints to stdout when empty.
+    std::string output;
+};
+
+// What one kernel spent on one point set.
+struct Result {
+    std::string kernel;
+    std::string fractal;
+    std::string pointSet;
+    std::uint64_t iterations = 0;
+    // Per repetition.
+    std::vector<double> nsPerIteration;
+};
+
+auto parseOptions(const std::vector<std::string>& args) -> BenchOptions
+{
+    auto options = BenchOptions();
+    for (std::size_t i = 1; i < args.size(); i++) {
+        const auto hasValue = i + 1 < args.size();
+        if (args[i] == "--iterations" && hasValue) {
+            options.iterations = std::max(2, std::stoi(args[++i]));
+        }
+        else if (args[i] == "--points" && hasValue) {
+            options.points = std::max(1, std::stoi(args[++i]));
+        }
+        else if (args[i] == "--warmup" && hasValue) {
+            options.warmup = std::max(0, std::stoi(args[++i]));
+        }
+        else if (args[i] == "--repetitions" && hasValue) {
+            options.repetitions = std::max(1, std::stoi(args[++i]));
+        }
+        else if (args[i] == "--output" && hasValue) {
+            options.output = args[++i];
+        }
+        else {
+            std::cerr << "unknown option " << args[i] << std::endl;
+        }
+    }
+    return options;
+}
+
+template <typename Real, bool TrackDerivative>
+auto escapeAt(Fractal fractal, const Point& p, int iterations) -> Escape<Real>
+{
+    return fractal == Fractal::JULIA
+               ? escape<Real, TrackDerivative>(Real(p.x),
+                                               Real(p.y),
+                                               Real(JULIA_SEED.x),
+                                               Real(JULIA_SEED.y),
+                                               Real(0),
+                                               iterations)
+               : escape<Real, TrackDerivative>(Real(p.x),
+                                               Real(p.y),
+                                               Real(p.x),
+                                               Real(p.y),
+                                               Real(1),
+                                               iterations);
+}
+
+// Draws candidates from a fixed sequence over the region the set lives in
+// and keeps those the double kernel puts in it, so every run and build gets
+// the same points.
+auto makePointSet(Fractal fractal, PointSet set, int count, int iterations)
+    -> std::vector<Point>
+{
+    auto center = Point{0.0, 0.0};
+    auto radius = 0.0;
+    switch (set) {
+        case PointSet::INTERIOR:
+            center = fractal == Fractal::JULIA ? Point{0.0, 0.0}
+                                               : Point{-0.2, 0.0};
+            radius = 0.3;
+            break;
+        case PointSet::EXTERIOR:
+            center = fractal == Fractal::JULIA ? Point{0.0, 0.0}
+                                               : Point{-0.5, 0.0};
+            radius = 1.5;
+            break;
+        case PointSet::BOUNDARY:
+            // Seahorse valley and a spiral of the Julia set.
+            center = fractal == Fractal::JULIA
+                         ? Point{0.1449684, -0.7425548}
+                         : Point{-0.743643887, 0.131825904};
+            radius = 0.01;
+            break;
+    }
+
+    // Numerical Recipes' LCG, seeded the same every time.
+    std::uint32_t state = 12345;
+    const auto next = [&]() {
+        state = state * 1664525u + 1013904223u;
+        return state / 4294967296.0;
+    };
+
+    std::vector<Point> points;
+    for (int attempt = 0;
+         attempt < count * MAX_ATTEMPTS && int(points.size()) < count;
+         attempt++) {
+        const auto p = Point{center.x + radius * (2 * next() - 1),
+                             center.y + radius * (2 * next() - 1)};
+        // Fixed point only starts within the escape radius.
+        if (!glFractals::fixedPointFits(p.x, p.y)) {
+            continue;
+        }
+        const auto n = escapeAt<double, false>(fractal, p, iterations)
+                           .iterations;
+        const auto inSet = (set == PointSet::INTERIOR)
+                               ? n >= iterations
+                               : (set == PointSet::EXTERIOR)
+                                     ? n < EXTERIOR_ITERATIONS
+                                     : n >= iterations / 8 && n < iterations;
+        if (inSet) {
+            points.push_back(p);
+        }
+    }
+    if (int(points.size()) < count) {
+        throw std::runtime_error("not enough points for a point set, try "
+                                 "fewer points or more iterations");
+    }
+    return points;
+}
+
+// Kernels iterate every point once per pass and return the iterations done.
+// The results feed sink so the compiler can't drop the work.
+template <typename Real, bool TrackDerivative>
+struct FloatingPoint {
+    static auto pass(Fractal fractal,
+                     const std::vector<Point>& points,
+                     int iterations,
+                     double& sink) -> std::uint64_t
+    {
+        std::uint64_t done = 0;
+        for (const auto& p : points) {
+            const auto e =
+                escapeAt<Real, TrackDerivative>(fractal, p, iterations);
+            done += e.iterations;
+            sink += double(e.smooth) + double(e.distance);
+        }
+        return done;
+    }
+};
+
+// Fixed point with Lanes points interleaved, 1 runs escapeFixed.
+template <int Lanes>
+struct FixedPoint {
+    static auto pass(Fractal fractal,
+                     const std::vector<Point>& points,
+                     int iterations,
+                     double& sink) -> std::uint64_t
+    {
+        using glFractals::Fixed;
+        using glFractals::toFixed;
+
+        const auto julia = fractal == Fractal::JULIA;
+        const auto seedX = toFixed(JULIA_SEED.x);
+        const auto seedY = toFixed(JULIA_SEED.y);
+        std::uint64_t done = 0;
+        if (Lanes == 1) {
+            for (const auto& p : points) {
+                const auto x = toFixed(p.x);
+                const auto y = toFixed(p.y);
+                done += glFractals::escapeFixed(
+                    x, y, julia ? seedX : x, julia ? seedY : y, iterations);
+            }
+        }
+        else {
+            glFractals::escapeFixedLanes<glFractals::QuadraticKernel, Lanes>(
+                static_cast<int>(points.size()),
+                iterations,
+                [&](int i, Fixed& zx, Fixed& zy, Fixed& cx, Fixed& cy) {
+                    zx = toFixed(points[i].x);
+                    zy = toFixed(points[i].y);
+                    cx = julia ? seedX : zx;
+                    cy = julia ? seedY : zy;
+                },
+                [&](int, int n) { done += n; });
+        }
+        sink += done;
+        return done;
+    }
+};
+
+template <typename Kernel>
+auto runPasses(Fractal fractal,
+               const std::vector<Point>& points,
+               int iterations,
+               int passes,
+               double& sink) -> std::uint64_t
+{
+    std::uint64_t done = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        done += Kernel::pass(fractal, points, iterations, sink);
+    }
+    return done;
+}
+
+template <typename Kernel>
+auto benchKernel(Fractal fractal,
+                 const std::vector<Point>& points,
+                 const BenchOptions& options,
+                 double& sink) -> Result
+{
+    using Clock = std::chrono::steady_clock;
+    const auto seconds = [](Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    // Doubles the passes until a repetition is long enough, which also warms
+    // up the caches and the clock.
+    auto passes = 1;
+    for (;;) {
+        const auto start = Clock::now();
+        runPasses<Kernel>(
+            fractal, points, options.iterations, passes, sink);
+        if (seconds(start) >= MIN_REPETITION_SECONDS) {
+            break;
+        }
+        passes *= 2;
+    }
+    for (int i = 0; i < options.warmup; i++) {
+        runPasses<Kernel>(
+            fractal, points, options.iterations, passes, sink);
+    }
+
+    auto result = Result();
+    for (int i = 0; i < options.repetitions; i++) {
+        const auto start = Clock::now();
+        const auto done = runPasses<Kernel>(
+            fractal, points, options.iterations, passes, sink);
+        result.nsPerIteration.push_back(seconds(start) * 1e9 / done);
+        result.iterations += done;
+    }
+    return result;
+}
+
+// One kernel instantiation under test.
+struct KernelEntry {
+    const char* name;
+    Result (*bench)(Fractal,
+                    const std::vector<Point>&,
+                    const BenchOptions&,
+                    double&);
+};
+
+const KernelEntry KERNELS[] = {
+    {"float", benchKernel<FloatingPoint<float, false>>},
+    {"double", benchKernel<FloatingPoint<double, false>>},
+    {"long-double", benchKernel<FloatingPoint<long double, false>>},
+    {"float-derivative", benchKernel<FloatingPoint<float, true>>},
+    {"double-derivative", benchKernel<FloatingPoint<double, true>>},
+    {"long-double-derivative", benchKernel<FloatingPoint<long double, true>>},
+    {"fixed-q4.60", benchKernel<FixedPoint<1>>},
+    {"fixed-q4.60-x2", benchKernel<FixedPoint<2>>},
+    {"fixed-q4.60-x4", benchKernel<FixedPoint<4>>},
+    {"fixed-q4.60-x8", benchKernel<FixedPoint<8>>},
+};
+
+void writeJson(std::ostream& out,
+               const BenchOptions& options,
+               const std::vector<Result>& results)
+{
+    out << "{\n";
+    out << "  \"iterations\": " << options.iterations << ",\n";
+    out << "  \"points\": " << options.points << ",\n";
+    out << "  \"repetitions\": " << options.repetitions << ",\n";
+    out << "  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+
+        auto sorted = r.nsPerIteration;
+        std::sort(sorted.begin(), sorted.end());
+        auto mean = 0.0;
+        for (const auto ns : sorted) {
+            mean += ns;
+        }
+        mean /= sorted.size();
+        auto variance = 0.0;
+        for (const auto ns : sorted) {
+            variance += (ns - mean) * (ns - mean);
+        }
+        const auto stddev =
+            sorted.size() > 1 ? std::sqrt(variance / (sorted.size() - 1)) : 0.0;
+
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"kernel\": \"" << r.kernel << "\", \"fractal\": \""
+            << r.fractal << "\", \"point_set\": \"" << r.pointSet
+            << "\", \"iterations\": " << r.iterations
+            << ", \"ns_per_iteration\": {\"min\": " << sorted.front()
+            << ", \"median\": " << sorted[sorted.size() / 2]
+            << ", \"mean\": " << mean << ", \"stddev\": " << stddev << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    try {
+        const auto options =
+            parseOptions(std::vector<std::string>(argv, argv + argc));
+
+        const Fractal fractals[] = {Fractal::MANDELBROT, Fractal::JULIA};
+        const PointSet sets[] = {
+            PointSet::INTERIOR, PointSet::EXTERIOR, PointSet::BOUNDARY};
+        const char* fractalNames[] = {"mandelbrot", "julia"};
+        const char* setNames[] = {"interior", "exterior", "boundary"};
+
+        auto sink = 0.0;
+        std::vector<Result> results;
+        for (const auto fractal : fractals) {
+            for (const auto set : sets) {
+                const auto points = makePointSet(
+                    fractal, set, options.points, options.iterations);
+                for (const auto& kernel : KERNELS) {
+                    const auto fractalName = fractalNames[int(fractal)];
+                    const auto setName = setNames[int(set)];
+                    std::cerr << fractalName << " " << setName << " "
+                              << kernel.name << "..." << std::flush;
+
+                    auto result = kernel.bench(fractal, points, options, sink);
+                    result.kernel = kernel.name;
+                    result.fractal = fractalName;
+                    result.pointSet = setName;
+                    std::cerr << " " << result.nsPerIteration.back()
+                              << " ns/iteration" << std::endl;
+                    results.push_back(result);
+                }
+            }
+        }
+        // Keeps the results alive, see runPasses.
+        if (sink == 0.0) {
+            std::cerr << "no work was done" << std::endl;
+        }
+
+        if (options.output.empty()) {
+            writeJson(std::cout, options, results);
+        }
+        else {
+            std::ofstream out(options.output, std::ios::trunc);
+            if (!out) {
+                throw std::runtime_error("failed to open " + options.output);
+            }
+            writeJson(out, options, results);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Renders frames with formulas other than the default both whole and tile by
+// tile from a TileJob that went through encodeJob and decodeJob, the way
+// workers get it, and fails when a pixel differs. Run by ctest.
+//
+//   glFractals_tile_check
+
+#include "Common.hpp"
+#include "CpuRenderer.hpp"
+#include "Formula.hpp"
+#include "FractalParams.hpp"
+#include "TileProtocol.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using glFractals::CpuRenderer;
+using glFractals::FractalType;
+using glFractals::PixelRect;
+
+namespace {
+
+// Doesn't divide the frame, so the last row and column of tiles are partial.
+constexpr int TILE_SIZE = 37;
+const Point2D<int> FRAME_SIZE = {160, 96};
+
+struct Case {
+    std::string name;
+    FractalType type;
+    std::string formula;
+    CpuRenderer::Arithmetic arithmetic;
+};
+
+const std::vector<Case> CASES = {
+    {"mandelbrot tricorn",
+     FractalType::MANDELBROT,
+     "tricorn",
+     CpuRenderer::Arithmetic::DOUBLE},
+    {"mandelbrot burning ship",
+     FractalType::MANDELBROT,
+     "burning-ship",
+     CpuRenderer::Arithmetic::DOUBLE},
+    {"julia multibrot3",
+     FractalType::JULIA,
+     "multibrot3",
+     CpuRenderer::Arithmetic::DOUBLE},
+    {"mandelbrot tricorn fixed point",
+     FractalType::MANDELBROT,
+     "tricorn",
+     CpuRenderer::Arithmetic::FIXED_POINT},
+};
+
+auto caseParams(const Case& c) -> glFractals::FractalParams
+{
+    auto params = glFractals::FractalParams();
+    params.type = c.type;
+    params.formula = glFractals::formulaByName(c.formula);
+    params.iterations = 200;
+    params.viewResolution = FRAME_SIZE;
+    params.compCenter = {-0.4, 0.1};
+    params.compResolution = {1.5 * FRAME_SIZE.x / FRAME_SIZE.y, 1.5};
+    params.seed = {-0.4, 0.6};
+    return params;
+}
+
+// Renders every tile of the frame with a renderer set up like a worker and
+// puts them together, rows bottom up.
+auto renderTiles(const glFractals::TileJob& job) -> std::vector<float>
+{
+    CpuRenderer renderer;
+    renderer.setArithmetic(job.arithmetic);
+
+    const auto& size = job.params.viewResolution;
+    std::vector<float> frame(static_cast<std::size_t>(size.x) * size.y);
+    std::vector<float> values;
+    for (int y0 = 0; y0 < size.y; y0 += TILE_SIZE) {
+        for (int x0 = 0; x0 < size.x; x0 += TILE_SIZE) {
+            const auto tile = PixelRect{x0,
+                                        y0,
+                                        std::min(size.x, x0 + TILE_SIZE) - 1,
+                                        std::min(size.y, y0 + TILE_SIZE) - 1};
+            renderer.renderTile(job.params, tile, values);
+            const auto width = tile.x1 - tile.x0 + 1;
+            for (int y = tile.y0; y <= tile.y1; y++) {
+                std::copy_n(values.begin() + (y - tile.y0) * width,
+                            width,
+                            frame.begin() + y * size.x + tile.x0);
+            }
+        }
+    }
+    return frame;
+}
+
+// Throws std::runtime_error describing the first failed expectation.
+void check(const Case& c)
+{
+    auto sent = glFractals::TileJob();
+    sent.params = caseParams(c);
+    sent.arithmetic = c.arithmetic;
+    const auto job = glFractals::decodeJob(glFractals::encodeJob(sent));
+    if (job.params != sent.params || job.arithmetic != sent.arithmetic) {
+        throw std::runtime_error("the decoded job differs from the sent one");
+    }
+
+    CpuRenderer renderer;
+    renderer.setArithmetic(c.arithmetic);
+    renderer.setSymmetry(false);
+    if (c.arithmetic == CpuRenderer::Arithmetic::FIXED_POINT &&
+        !renderer.fixedPointCovers(sent.params)) {
+        throw std::runtime_error("the frame is out of fixed point's reach");
+    }
+    std::vector<float> expected;
+    renderer.render(sent.params, expected);
+
+    // The same frame with the default formula, so a formula lost on the way
+    // can't go unnoticed.
+    auto plainParams = sent.params;
+    plainParams.formula = glFractals::Formula();
+    std::vector<float> plain;
+    renderer.render(plainParams, plain);
+    if (plain == expected) {
+        throw std::runtime_error("the formula doesn't change the frame");
+    }
+
+    const auto tiled = renderTiles(job);
+    for (std::size_t i = 0; i < expected.size(); i++) {
+        if (tiled[i] != expected[i]) {
+            char message[128];
+            std::snprintf(message,
+                          sizeof(message),
+                          "pixel %d, %d is %g in tiles but %g in the frame",
+                          static_cast<int>(i % FRAME_SIZE.x),
+                          static_cast<int>(i / FRAME_SIZE.x),
+                          tiled[i],
+                          expected[i]);
+            throw std::runtime_error(message);
+        }
+    }
+}
+
+} // namespace
+
+auto main() -> int
+{
+    auto failed = 0;
+    for (const auto& c : CASES) {
+        try {
+            check(c);
+            std::cout << c.name << ": ok" << std::endl;
+        }
+        catch (const std::exception& e) {
+            std::cout << c.name << ": " << e.what() << std::endl;
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -1,12 +1,10 @@
 #include "JuliaController.hpp"
 #include "Event.hpp"
-#include "Shader.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
-#include <sstream>
 
 namespace glFractals {
 
@@ -73,13 +71,10 @@ auto JuliaController::notifyClose() -> bool
     return controller_.notifyClose();
 }
 
-auto JuliaController::stateStrings() const -> std::vector<std::string>
+void JuliaController::stateLines(HudText& hud) const
 {
-    auto stateStrings = controller_.stateStrings();
-    std::stringstream ss;
-    ss << "seed: " << str(seed_);
-    stateStrings.push_back(ss.str());
-    return stateStrings;
+    controller_.stateLines(hud);
+    hud.addLine("seed: %e, %e", seed_.x, seed_.y);
 }
 
 void JuliaController::resetCamera()
@@ -90,11 +85,12 @@ void JuliaController::resetCamera()
     prevCursor_ = {};
 }
 
-void JuliaController::programShader(Shader& shader) const
+auto JuliaController::params() const -> FractalParams
 {
-    controller_.programShader(shader);
-    shader.setUniform("seedX", seed_.x);
-    shader.setUniform("seedY", seed_.y);
+    auto params = controller_.params();
+    params.type = FractalType::JULIA;
+    params.seed = {seed_.x, seed_.y};
+    return params;
 }
 
 } // namespace glFractals
\ No newline at end of file
@@ -20,8 +20,8 @@ public:
 
     void update(float delta) override;
     auto shouldClose() const -> bool override;
-    auto stateStrings() const -> std::vector<std::string> override;
-    void programShader(Shader& shader) const override;
+    void stateLines(HudText& hud) const override;
+    auto params() const -> FractalParams override;
 
     // Listener functions
     auto notifyClose() -> bool override;
@@ -1,6 +1,5 @@
 #include "MandelbrotController.hpp"
 #include "Event.hpp"
-#include "Shader.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -14,8 +13,9 @@ static bool pressedOrRepeated(ButtonState state)
     return state == ButtonState::PRESSED || state == ButtonState::REPEATED;
 }
 
-MandelbrotController::MandelbrotController(Point2D<int> resolution)
-    : resolution_(resolution)
+MandelbrotController::MandelbrotController(Point2D<int> resolution,
+                                           FractalType type)
+    : type_(type), resolution_(resolution)
 {
 }
 
@@ -23,10 +23,8 @@ void MandelbrotController::update(float delta)
 {
     // When zooming, we want to keep the point under the mouse the same.
     if (zoomFactor_ != 1.0f) {
-        auto factor = (zoomFactor_ > 1.0f) ? -(1.0f / ZOOM_FACTOR - 1.0f)
-                                           : (1.0f - ZOOM_FACTOR);
         auto deltaCursor = screenToComp(curCursor_) - compCenter_;
-        compCenter_ = compCenter_ + factor * deltaCursor;
+        compCenter_ = compCenter_ + (1.0f - zoomFactor_) * deltaCursor;
     }
     compHeight_ *= zoomFactor_;
 
@@ -74,6 +72,13 @@ void MandelbrotController::notifyEvent(Event event, ButtonState state)
                 iterations_ = std::max(0, iterations_ - 1);
             }
             break;
+        case Event::TOGGLE_DISTANCE_ESTIMATION:
+            if (state == ButtonState::PRESSED) {
+                renderMode_ = (renderMode_ == RenderMode::ESCAPE_TIME)
+                                  ? RenderMode::DISTANCE_ESTIMATE
+                                  : RenderMode::ESCAPE_TIME;
+            }
+            break;
         case Event::RESET_CAMERA:
             if (state == ButtonState::PRESSED) {
                 resetCamera();
@@ -101,11 +106,10 @@ void MandelbrotController::notifyMouse(float cursorX,
 
     curCursor_ = {cursorX, cursorY};
 
-    if (scrollY > 0) {
-        zoomFactor_ = ZOOM_FACTOR;
-    }
-    else if (scrollY < 0) {
-        zoomFactor_ = 1.0 / ZOOM_FACTOR;
+    // Scrolls arrive summed, and high resolution wheels send fractions of a
+    // step, so every step zooms by the same factor.
+    if (scrollY != 0) {
+        zoomFactor_ *= std::pow(ZOOM_FACTOR, scrollY);
     }
 }
 
@@ -141,41 +145,37 @@ void MandelbrotController::resetCamera()
     curCursor_ = prevCursor_;
 }
 
-auto MandelbrotController::stateStrings() const -> std::vector<std::string>
+void MandelbrotController::stateLines(HudText& hud) const
 {
-    std::vector<std::string> strs;
-
     auto cursorPos = compCursor();
-    std::stringstream ss;
-    ss << "mouse: " << str(cursorPos);
-    strs.push_back(ss.str());
+    hud.addLine("mouse: %e, %e", cursorPos.x, cursorPos.y);
 
-    ss.str("");
     auto center = compCenter();
-    ss << "center: " << str(center);
-    strs.push_back(ss.str());
+    hud.addLine("center: %e, %e", center.x, center.y);
 
-    ss.str("");
-    ss << "iterations: " << iterations();
-    strs.push_back(ss.str());
+    hud.addLine("iterations: %d", iterations());
 
-    return strs;
+    // The Buddhabrot has no distance estimate to color by.
+    if (type_ != FractalType::BUDDHABROT) {
+        hud.addLine((renderMode_ == RenderMode::DISTANCE_ESTIMATE)
+                        ? "mode: distance estimate"
+                        : "mode: escape time");
+    }
 }
 
-void MandelbrotController::programShader(Shader& shader) const
+auto MandelbrotController::params() const -> FractalParams
 {
-    shader.setUniform("iterations", iterations());
-
-    auto res = compResolution();
-    shader.setUniform("compWidth", static_cast<float>(res.x));
-    shader.setUniform("compHeight", static_cast<float>(res.y));
-
-    auto center = compCenter();
-    shader.setUniform("compCenterX", center.x);
-    shader.setUniform("compCenterY", center.y);
-
-    shader.setUniform("viewWidth", static_cast<float>(resolution_.x));
-    shader.setUniform("viewHeight", static_cast<float>(resolution_.y));
+    auto params = FractalParams();
+    params.type = type_;
+    params.mode = renderMode_;
+    params.iterations = iterations();
+    params.viewResolution = resolution_;
+
+    const auto center = compCenter();
+    params.compCenter = {center.x, center.y};
+    const auto res = compResolution();
+    params.compResolution = {res.x, res.y};
+    return params;
 }
 
 void MandelbrotController::notifyResolution(int newWidth, int newHeight)
@@ -8,12 +8,14 @@
 namespace glFractals {
 class MandelbrotController : public StateController {
 public:
-    MandelbrotController(Point2D<int> resolution);
+    // The Buddhabrot lives in the same plane, so type can be BUDDHABROT too.
+    MandelbrotController(Point2D<int> resolution,
+                         FractalType type = FractalType::MANDELBROT);
 
     void update(float delta) override;
     auto shouldClose() const -> bool override;
-    auto stateStrings() const -> std::vector<std::string> override;
-    void programShader(Shader& shader) const override;
+    void stateLines(HudText& hud) const override;
+    auto params() const -> FractalParams override;
 
     // Listener functions
     auto notifyClose() -> bool override;
@@ -37,9 +39,11 @@ public:
 
 private:
     bool shouldClose_ = false;
+    FractalType type_ = FractalType::MANDELBROT;
 
     Point2D<int> resolution_ = {};
     int iterations_ = 100;
+    RenderMode renderMode_ = RenderMode::ESCAPE_TIME;
 
     int keyMoveUp_ = 0;
     int keyMoveDown_ = 0;
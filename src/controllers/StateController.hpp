@@ -2,6 +2,8 @@
 
 #include "CloseListener.hpp"
 #include "Common.hpp"
+#include "FractalParams.hpp"
+#include "HudText.hpp"
 #include "KeyListener.hpp"
 #include "MouseListener.hpp"
 #include "ResolutionChangeListener.hpp"
@@ -10,7 +12,6 @@
 #include <vector>
 
 namespace glFractals {
-class Shader;
 class StateController : public KeyListener,
                         public CloseListener,
                         public MouseListener,
@@ -22,10 +23,11 @@ public:
 
     virtual auto shouldClose() const -> bool = 0;
 
-    // Returns window state information as strings.
-    virtual auto stateStrings() const -> std::vector<std::string> = 0;
+    // Adds window state information to the HUD.
+    virtual void stateLines(HudText& hud) const = 0;
 
-    virtual void programShader(Shader& shader) const = 0;
+    // Returns the parameters of the current frame.
+    virtual auto params() const -> FractalParams = 0;
 
     // Listener functions
     // virtual auto notifyClose() -> bool override;
@@ -0,0 +1,473 @@
+#include "BuddhabrotRenderer.hpp"
+
+#include "Kernels.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace glFractals {
+
+// Workers look at the clock once per this many candidate points.
+static constexpr int SAMPLES_PER_CLOCK_CHECK = 256;
+static constexpr std::uint64_t RNG_SEED = 0x9e3779b97f4a7c15;
+static constexpr int NUM_CHANNELS = 3;
+static constexpr double TWO_PI = 6.283185307179586;
+// Fraction of the lit pixels of a channel that stay below full brightness.
+static constexpr double WHITE_PERCENTILE = 0.999;
+
+// Metropolis chains mostly take small steps, between MIN and MAX_MUTATION
+// times the height of the view, to explore around contributing points. The
+// large steps draw c uniformly, so the chain can't get stuck in one region.
+static constexpr double LARGE_MUTATION_PROBABILITY = 0.2;
+static constexpr double MIN_MUTATION = 1.0e-4;
+static constexpr double MAX_MUTATION = 0.1;
+// Steps a new chain takes before it deposits anything, so its arbitrary start
+// doesn't show.
+static constexpr int BURN_IN_MUTATIONS = 1000;
+
+namespace {
+// Maps orbit points to histogram bins, the inverse of the pixel to complex
+// mapping of the other engines.
+struct View {
+    explicit View(const FractalParams& params)
+        : width(params.viewResolution.x), height(params.viewResolution.y),
+          scaleX(width / params.compResolution.x),
+          scaleY(height / params.compResolution.y),
+          offsetX(width / 2.0 - params.compCenter.x * scaleX),
+          offsetY(height / 2.0 - params.compCenter.y * scaleY)
+    {
+    }
+
+    // Index of the first channel of the bin, -1 outside the view.
+    auto bin(double x, double y) const -> long long
+    {
+        const auto px = std::floor(x * scaleX + offsetX);
+        const auto py = std::floor(y * scaleY + offsetY);
+        if (!(px >= 0 && py >= 0 && px < width && py < height)) {
+            return -1;
+        }
+        return (static_cast<long long>(py) * width +
+                static_cast<long long>(px)) *
+               NUM_CHANNELS;
+    }
+
+    int width;
+    int height;
+    double scaleX;
+    double scaleY;
+    double offsetX;
+    double offsetY;
+};
+} // namespace
+
+// Only c in the escape disk outside the main cardioid and the period 2 bulb
+// can contribute. Points in those components never escape, so this skips
+// iterating them to the limit.
+static auto sampleable(double x, double y) -> bool
+{
+    if (x * x + y * y > ESCAPE_RADIUS_SQ) {
+        return false;
+    }
+    const auto xq = x - 0.25;
+    const auto q = xq * xq + y * y;
+    if (q * (q + xq) <= 0.25 * y * y) {
+        return false;
+    }
+    return (x + 1.0) * (x + 1.0) + y * y > 0.0625;
+}
+
+// Fills orbit with z_1 up to the first point outside the escape radius.
+// Returns the number of points, or 0 when c doesn't escape in time.
+static auto
+traceOrbit(double cx, double cy, int maxIterations, Point2D<double>* orbit)
+    -> int
+{
+    double zx = 0.0;
+    double zy = 0.0;
+    for (int n = 0; n < maxIterations;) {
+        const auto x = zx * zx - zy * zy + cx;
+        const auto y = 2.0 * zx * zy + cy;
+        orbit[n++] = {x, y};
+        if (x * x + y * y > ESCAPE_RADIUS_SQ) {
+            return n;
+        }
+        zx = x;
+        zy = y;
+    }
+    return 0;
+}
+
+// Bit k is set when the orbit lands in channel k.
+static auto channelMask(int orbitLength, const std::array<int, 3>& limits)
+    -> unsigned
+{
+    unsigned channels = 0;
+    for (int k = 0; k < NUM_CHANNELS; k++) {
+        channels |= unsigned(orbitLength <= limits[k]) << k;
+    }
+    return channels;
+}
+
+// The set is symmetric about the real axis and so is the sampled square, so the
+// mirrored orbit, which is the orbit of conj(c), comes for free. Both count.
+static auto
+countInView(const View& view, const Point2D<double>* orbit, int orbitLength)
+    -> int
+{
+    int count = 0;
+    for (int i = 0; i < orbitLength; i++) {
+        count += (view.bin(orbit[i].x, orbit[i].y) >= 0) +
+                 (view.bin(orbit[i].x, -orbit[i].y) >= 0);
+    }
+    return count;
+}
+
+static void deposit(const View& view,
+                    const Point2D<double>* orbit,
+                    int orbitLength,
+                    unsigned channels,
+                    float weight,
+                    float* histogram)
+{
+    float channelWeights[NUM_CHANNELS];
+    for (int k = 0; k < NUM_CHANNELS; k++) {
+        channelWeights[k] = ((channels >> k) & 1) ? weight : 0.0f;
+    }
+
+    for (int i = 0; i < orbitLength; i++) {
+        for (const auto y : {orbit[i].y, -orbit[i].y}) {
+            const auto bin = view.bin(orbit[i].x, y);
+            if (bin < 0) {
+                continue;
+            }
+            for (int k = 0; k < NUM_CHANNELS; k++) {
+                histogram[bin + k] += channelWeights[k];
+            }
+        }
+    }
+}
+
+BuddhabrotRenderer::BuddhabrotRenderer(unsigned threads)
+    : threads_(threadCount(threads)), workers_(threads_)
+{
+    for (unsigned t = 0; t < threads_; t++) {
+        workers_[t].rng.seed(RNG_SEED + t);
+    }
+}
+
+void BuddhabrotRenderer::render(const FractalParams& params,
+                                std::vector<float>& colors)
+{
+    if (params != params_ || density_.empty()) {
+        reset(params);
+    }
+
+    auto remaining = std::uint64_t(0);
+    if (sampleLimit_ == 0) {
+        remaining = ~std::uint64_t(0);
+    }
+    else if (samples_ < sampleLimit_) {
+        remaining = sampleLimit_ - samples_;
+    }
+
+    if (remaining > 0 && !density_.empty()) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto deadline =
+            start + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::duration<double>(batchSeconds_));
+
+        std::uint64_t batchSamples = 0;
+        for (auto& worker : workers_) {
+            batchSamples -= worker.samples;
+        }
+        runThreads(threads_, [&](unsigned t) {
+            // Thread 0 also takes the remainder of the quota.
+            auto quota = remaining / threads_;
+            if (t == 0) {
+                quota += remaining % threads_;
+            }
+            sample(workers_[t], quota, deadline);
+        });
+        for (auto& worker : workers_) {
+            batchSamples += worker.samples;
+        }
+        merge();
+
+        const auto seconds = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        samples_ += batchSamples;
+        orbitsPerSecond_ = seconds > 0.0 ? batchSamples / seconds : 0.0;
+    }
+    else {
+        orbitsPerSecond_ = 0.0;
+    }
+
+    toneMap(colors);
+}
+
+void BuddhabrotRenderer::reset(const FractalParams& params)
+{
+    params_ = params;
+    const auto pixels = static_cast<std::size_t>(
+                            std::max(0, params.viewResolution.x)) *
+                        std::max(0, params.viewResolution.y);
+    density_.assign(pixels * NUM_CHANNELS, 0);
+    samples_ = 0;
+
+    const auto channelLimits = limits();
+    const auto maxIterations =
+        *std::max_element(channelLimits.begin(), channelLimits.end());
+    for (auto& worker : workers_) {
+        worker.histogram.assign(density_.size(), 0.0f);
+        worker.orbit.resize(std::max(0, maxIterations));
+        worker.proposal.resize(worker.orbit.size());
+        worker.contribution = 0;
+        worker.mutations = 0;
+        worker.accepted = 0;
+    }
+}
+
+auto BuddhabrotRenderer::limits() const -> std::array<int, 3>
+{
+    auto limits = channelIterations_;
+    for (auto& limit : limits) {
+        if (limit <= 0) {
+            limit = params_.iterations;
+        }
+    }
+    return limits;
+}
+
+void BuddhabrotRenderer::sample(Worker& worker,
+                                std::uint64_t quota,
+                                std::chrono::steady_clock::time_point deadline)
+{
+    const auto channelLimits = limits();
+
+    // Only iterated orbits count towards the quota. Every candidate iterates
+    // at most one, so a batch can't overshoot it.
+    std::uint64_t sampled = 0;
+    while (sampled < quota && std::chrono::steady_clock::now() < deadline) {
+        const auto batch = std::min<std::uint64_t>(SAMPLES_PER_CLOCK_CHECK,
+                                                   quota - sampled);
+        for (std::uint64_t s = 0; s < batch; s++) {
+            if (sampling_ == Sampling::METROPOLIS) {
+                sampled += mutate(worker, channelLimits);
+            }
+            else {
+                sampled += sampleUniform(worker, channelLimits);
+            }
+        }
+    }
+    worker.samples += sampled;
+}
+
+auto BuddhabrotRenderer::sampleUniform(Worker& worker,
+                                       const std::array<int, 3>& limits)
+    -> bool
+{
+    auto coordinate = std::uniform_real_distribution<double>(-2.0, 2.0);
+    const auto cx = coordinate(worker.rng);
+    const auto cy = coordinate(worker.rng);
+    if (!sampleable(cx, cy)) {
+        return false;
+    }
+
+    const auto length = traceOrbit(
+        cx, cy, static_cast<int>(worker.orbit.size()), worker.orbit.data());
+    if (length > 0) {
+        deposit(View(params_),
+                worker.orbit.data(),
+                length,
+                channelMask(length, limits),
+                1.0f,
+                worker.histogram.data());
+    }
+    return true;
+}
+
+auto BuddhabrotRenderer::mutate(Worker& worker,
+                                const std::array<int, 3>& limits) -> bool
+{
+    const auto view = View(params_);
+    const auto maxIterations = static_cast<int>(worker.orbit.size());
+    auto unit = std::uniform_real_distribution<double>(0.0, 1.0);
+    auto coordinate = std::uniform_real_distribution<double>(-2.0, 2.0);
+
+    // Proposals are symmetric, q(a -> b) = q(b -> a), so accepting with
+    // probability f(b) / f(a) makes the chain sample c proportional to f.
+    auto c = Point2D<double>();
+    if (worker.contribution == 0 ||
+        unit(worker.rng) < LARGE_MUTATION_PROBABILITY) {
+        c = {coordinate(worker.rng), coordinate(worker.rng)};
+    }
+    else {
+        const auto height = params_.compResolution.y;
+        const auto radius =
+            MAX_MUTATION * height *
+            std::exp(std::log(MIN_MUTATION / MAX_MUTATION) * unit(worker.rng));
+        const auto angle = TWO_PI * unit(worker.rng);
+        c = {worker.c.x + radius * std::cos(angle),
+             worker.c.y + radius * std::sin(angle)};
+    }
+
+    // Points outside the sampled square have f = 0, which keeps the large
+    // mutations symmetric.
+    const auto traced =
+        std::abs(c.x) <= 2.0 && std::abs(c.y) <= 2.0 && sampleable(c.x, c.y);
+    auto length = 0;
+    if (traced) {
+        length = traceOrbit(c.x, c.y, maxIterations, worker.proposal.data());
+    }
+    const auto contribution =
+        length > 0 ? countInView(view, worker.proposal.data(), length) : 0;
+
+    if (worker.contribution == 0) {
+        // Still looking for a first contributing point to start from.
+        if (contribution > 0) {
+            std::swap(worker.orbit, worker.proposal);
+            worker.c = c;
+            worker.orbitLength = length;
+            worker.contribution = contribution;
+            worker.burnIn = BURN_IN_MUTATIONS;
+        }
+        return traced;
+    }
+
+    worker.mutations++;
+    if (contribution > 0 &&
+        unit(worker.rng) * worker.contribution < contribution) {
+        std::swap(worker.orbit, worker.proposal);
+        worker.c = c;
+        worker.orbitLength = length;
+        worker.contribution = contribution;
+        worker.accepted++;
+    }
+
+    if (worker.burnIn > 0) {
+        worker.burnIn--;
+        return traced;
+    }
+
+    // The chain visits c proportionally to f(c), so weighting by 1 / f(c)
+    // leaves the density uniform sampling converges to, up to a constant the
+    // tone mapping normalizes away.
+    deposit(view,
+            worker.orbit.data(),
+            worker.orbitLength,
+            channelMask(worker.orbitLength, limits),
+            1.0f / worker.contribution,
+            worker.histogram.data());
+    return traced;
+}
+
+void BuddhabrotRenderer::merge()
+{
+    // Every thread sums and clears its own slice of all histograms.
+    const auto size = density_.size();
+    runThreads(threads_, [&](unsigned t) {
+        const auto begin = size * t / threads_;
+        const auto end = size * (t + 1) / threads_;
+        for (auto& worker : workers_) {
+            auto* histogram = worker.histogram.data();
+            for (auto i = begin; i < end; i++) {
+                density_[i] += histogram[i];
+                histogram[i] = 0.0f;
+            }
+        }
+    });
+}
+
+void BuddhabrotRenderer::toneMap(std::vector<float>& colors) const
+{
+    colors.resize(density_.size());
+
+    // A few pixels always collect far more orbits than the rest, more so
+    // with weighted Metropolis deposits. Normalizing to a high percentile
+    // instead of the maximum keeps them from darkening everything else.
+    double whitePoint[NUM_CHANNELS] = {};
+    std::vector<double> channel;
+    for (int k = 0; k < NUM_CHANNELS; k++) {
+        channel.clear();
+        for (auto i = std::size_t(k); i < density_.size(); i += NUM_CHANNELS) {
+            if (density_[i] > 0.0) {
+                channel.push_back(density_[i]);
+            }
+        }
+        if (channel.empty()) {
+            continue;
+        }
+        const auto nth = channel.begin() + static_cast<std::ptrdiff_t>(
+                                               WHITE_PERCENTILE *
+                                               (channel.size() - 1));
+        std::nth_element(channel.begin(), nth, channel.end());
+        whitePoint[k] = *nth;
+    }
+
+    // The density spans orders of magnitude, the square root keeps the faint
+    // orbits visible next to the bright ones.
+    for (std::size_t i = 0; i < density_.size(); i++) {
+        const auto white = whitePoint[i % NUM_CHANNELS];
+        colors[i] = white > 0.0 ? static_cast<float>(std::sqrt(
+                                      std::min(1.0, density_[i] / white)))
+                                : 0.0f;
+    }
+}
+
+void BuddhabrotRenderer::setChannelIterations(
+    const std::array<int, 3>& iterations)
+{
+    channelIterations_ = iterations;
+    density_.clear();
+}
+
+void BuddhabrotRenderer::setSampling(Sampling sampling)
+{
+    sampling_ = sampling;
+    density_.clear();
+}
+
+void BuddhabrotRenderer::setBatchSeconds(double seconds)
+{
+    batchSeconds_ = seconds;
+}
+
+void BuddhabrotRenderer::setSampleLimit(std::uint64_t samples)
+{
+    sampleLimit_ = samples;
+}
+
+auto BuddhabrotRenderer::threads() const -> unsigned { return threads_; }
+
+auto BuddhabrotRenderer::samples() const -> std::uint64_t { return samples_; }
+
+void BuddhabrotRenderer::stateLines(HudText& hud) const
+{
+    const auto channelLimits = limits();
+    hud.addLine("channels: %d, %d, %d iterations",
+                channelLimits[0],
+                channelLimits[1],
+                channelLimits[2]);
+
+    hud.addLine("buddhabrot: %.2e orbits, %.2e orbits/s on %u threads",
+                double(samples_),
+                orbitsPerSecond_,
+                threads_);
+
+    if (sampling_ == Sampling::METROPOLIS) {
+        std::uint64_t mutations = 0;
+        std::uint64_t accepted = 0;
+        for (const auto& worker : workers_) {
+            mutations += worker.mutations;
+            accepted += worker.accepted;
+        }
+        hud.addLine("metropolis: %llu%% of mutations accepted",
+                    static_cast<unsigned long long>(
+                        mutations > 0 ? accepted * 100 / mutations : 0));
+    }
+}
+
+} // namespace glFractals
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Common.hpp"
+#include "FractalParams.hpp"
+#include "HudText.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// Renders the Buddhabrot, the density of the orbits of points escaping the
+// Mandelbrot set. Every color channel has its own iteration limit, which gives
+// the Nebulabrot when they differ. Every thread samples into its own
+// histogram, so threads never touch shared memory while iterating.
+class BuddhabrotRenderer {
+public:
+    enum class Sampling {
+        // Samples c uniformly over the square [-2, 2]^2 and skips the points
+        // that can't contribute, outside the escape disk or inside the main
+        // cardioid or the period 2 bulb.
+        UNIFORM,
+        // Every thread runs a Metropolis-Hastings chain over c, with the
+        // number of orbit points landing in the view as target density, and
+        // weights every deposit by its inverse so the density stays
+        // unbiased. Converges much faster when zoomed in, where nearly every
+        // uniform orbit misses the view.
+        METROPOLIS
+    };
+
+    // A thread count of 0 uses every hardware thread.
+    explicit BuddhabrotRenderer(unsigned threads = 0);
+
+    // Samples orbits for one batch, adds them to the density and fills colors
+    // with three unit interval values per pixel, rows bottom up. The density
+    // starts over whenever params change.
+    void render(const FractalParams& params, std::vector<float>& colors);
+
+    // An orbit escaping after n iterations lands in every channel whose limit
+    // is at least n. A limit of 0 follows the iterations of the params, so the
+    // default is the grayscale Buddhabrot.
+    void setChannelIterations(const std::array<int, 3>& iterations);
+    // Wall time spent sampling per render call.
+    void setBatchSeconds(double seconds);
+    // Stops sampling after this many orbits, 0 never stops. Like samples,
+    // counts only the orbits actually iterated, not the skipped points.
+    void setSampleLimit(std::uint64_t samples);
+    void setSampling(Sampling sampling);
+
+    auto threads() const -> unsigned;
+    auto samples() const -> std::uint64_t;
+
+    // Adds statistics of the last render to the HUD.
+    void stateLines(HudText& hud) const;
+
+private:
+    // Everything one thread touches while sampling.
+    struct Worker {
+        std::mt19937_64 rng;
+        // Weighted orbit counts of the current batch, interleaved RGB.
+        std::vector<float> histogram;
+        std::vector<Point2D<double>> orbit;
+        // Orbits iterated so far.
+        std::uint64_t samples = 0;
+
+        // State of the Metropolis chain, orbit holds the orbit of c. The
+        // chain hasn't started while the contribution is 0.
+        Point2D<double> c = {};
+        int orbitLength = 0;
+        int contribution = 0;
+        int burnIn = 0;
+        std::vector<Point2D<double>> proposal;
+        std::uint64_t mutations = 0;
+        std::uint64_t accepted = 0;
+    };
+
+    unsigned threads_ = 1;
+    std::array<int, 3> channelIterations_ = {};
+    double batchSeconds_ = 0.05;
+    std::uint64_t sampleLimit_ = 0;
+    Sampling sampling_ = Sampling::UNIFORM;
+
+    FractalParams params_ = {};
+    std::vector<Worker> workers_;
+    // Sum of the histograms of every batch since the params changed.
+    std::vector<double> density_;
+    std::uint64_t samples_ = 0;
+    double orbitsPerSecond_ = 0.0;
+
+    void reset(const FractalParams& params);
+    auto limits() const -> std::array<int, 3>;
+    void sample(Worker& worker,
+                std::uint64_t quota,
+                std::chrono::steady_clock::time_point deadline);
+    // Both return whether they iterated an orbit.
+    auto sampleUniform(Worker& worker, const std::array<int, 3>& limits)
+        -> bool;
+    auto mutate(Worker& worker, const std::array<int, 3>& limits) -> bool;
+    void merge();
+    void toneMap(std::vector<float>& colors) const;
+};
+
+} // namespace glFractals
@@ -0,0 +1,448 @@
+#include "CpuRenderer.hpp"
+
+#include "FixedPoint.hpp"
+#include "Kernels.hpp"
+#include "Parallel.hpp"
+#include "Symmetry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <initializer_list>
+
+namespace glFractals {
+
+// Disk filling hands out square tiles of this size to the threads, and stops
+// subdividing below MIN_FILL_SIZE pixels.
+static constexpr int FILL_TILE_SIZE = 64;
+static constexpr int MIN_FILL_SIZE = 4;
+
+namespace {
+// Maps pixels to the complex plane the same way the shaders do and iterates
+// the formula kernel for the fractal type.
+template <typename Kernel>
+struct Sampler {
+    explicit Sampler(const FractalParams& p)
+        : params(p), pixelSize(p.compResolution.y / p.viewResolution.y),
+          julia(p.type == FractalType::JULIA)
+    {
+    }
+
+    // Pixel centers are at half coordinates.
+    auto compX(double px) const -> double
+    {
+        const auto& res = params.viewResolution;
+        return (px - res.x / 2.0) / res.x * params.compResolution.x +
+               params.compCenter.x;
+    }
+
+    auto compY(double py) const -> double
+    {
+        const auto& res = params.viewResolution;
+        return (py - res.y / 2.0) / res.y * params.compResolution.y +
+               params.compCenter.y;
+    }
+
+    template <bool TrackDerivative>
+    auto escapeAt(double x, double y) const -> Escape<double>
+    {
+        return julia ? escape<double, TrackDerivative, Kernel>(
+                           x,
+                           y,
+                           params.seed.x,
+                           params.seed.y,
+                           0.0,
+                           params.iterations)
+                     : escape<double, TrackDerivative, Kernel>(
+                           x, y, x, y, 1.0, params.iterations);
+    }
+
+    // Disk filling interpolates the smooth iteration count, so computed
+    // pixels use it too or the filled regions would stand out.
+    auto smoothValue(const Escape<double>& e) const -> float
+    {
+        if (params.mode == RenderMode::DISTANCE_ESTIMATE) {
+            return distanceValue(e, params.iterations, pixelSize);
+        }
+        if (e.iterations >= params.iterations) {
+            return 1.0f;
+        }
+        return static_cast<float>(e.smooth / params.iterations);
+    }
+
+    const FractalParams& params;
+    double pixelSize;
+    bool julia;
+};
+
+// Fills one tile of the image. Evaluates the distance estimate at the center
+// of a rectangle and when the proven exterior disk covers the rectangle,
+// interpolates its corners over it. Otherwise subdivides, so only the area
+// around the boundary gets iterated pixel by pixel.
+template <typename Kernel>
+class DiskFiller {
+public:
+    DiskFiller(const Sampler<Kernel>& sampler,
+               float* values,
+               char* computed,
+               std::uint64_t& iterated)
+        : sampler_(sampler), values_(values), computed_(computed),
+          iterated_(iterated)
+    {
+    }
+
+    // Corners are inclusive pixel coordinates.
+    void fill(int x0, int y0, int x1, int y1)
+    {
+        if (x1 - x0 < MIN_FILL_SIZE || y1 - y0 < MIN_FILL_SIZE) {
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    pixel(x, y);
+                }
+            }
+            return;
+        }
+
+        if (provenExterior(x0, y0, x1, y1)) {
+            interpolate(x0, y0, x1, y1);
+            return;
+        }
+
+        // Children share their middle row and column, computed only once.
+        const auto mx = (x0 + x1) / 2;
+        const auto my = (y0 + y1) / 2;
+        fill(x0, y0, mx, my);
+        fill(mx, y0, x1, my);
+        fill(x0, my, mx, y1);
+        fill(mx, my, x1, y1);
+    }
+
+private:
+    auto index(int x, int y) const -> std::size_t
+    {
+        return static_cast<std::size_t>(y) *
+                   sampler_.params.viewResolution.x +
+               x;
+    }
+
+    auto pixel(int x, int y) -> float
+    {
+        const auto i = index(x, y);
+        if (!computed_[i]) {
+            const auto e = sampler_.template escapeAt<true>(
+                sampler_.compX(x + 0.5), sampler_.compY(y + 0.5));
+            values_[i] = sampler_.smoothValue(e);
+            computed_[i] = 1;
+            iterated_++;
+        }
+        return values_[i];
+    }
+
+    auto provenExterior(int x0, int y0, int x1, int y1) -> bool
+    {
+        const auto e = sampler_.template escapeAt<true>(
+            sampler_.compX((x0 + x1) / 2.0 + 0.5),
+            sampler_.compY((y0 + y1) / 2.0 + 0.5));
+        if (e.iterations >= sampler_.params.iterations ||
+            !std::isfinite(e.distance)) {
+            return false;
+        }
+
+        // The disk must reach every pixel center of the rectangle.
+        const auto radius = 0.5 * sampler_.pixelSize *
+                            std::hypot(double(x1 - x0), double(y1 - y0));
+        if (e.distance <= radius) {
+            return false;
+        }
+
+        // The corners are inside the disk so they escape too. Checking costs
+        // nothing since they are needed for the interpolation anyway, and
+        // guards against the estimate blowing up next to precritical points
+        // of disconnected Julia sets.
+        return escaped(x0, y0) && escaped(x1, y0) && escaped(x0, y1) &&
+               escaped(x1, y1);
+    }
+
+    // Only points inside the set get the value 1.
+    auto escaped(int x, int y) -> bool { return pixel(x, y) < 1.0f; }
+
+    void interpolate(int x0, int y0, int x1, int y1)
+    {
+        const auto v00 = pixel(x0, y0);
+        const auto v10 = pixel(x1, y0);
+        const auto v01 = pixel(x0, y1);
+        const auto v11 = pixel(x1, y1);
+
+        for (int y = y0; y <= y1; y++) {
+            const auto ty = static_cast<float>(y - y0) / (y1 - y0);
+            for (int x = x0; x <= x1; x++) {
+                const auto i = index(x, y);
+                if (computed_[i]) {
+                    continue;
+                }
+                const auto tx = static_cast<float>(x - x0) / (x1 - x0);
+                values_[i] = (1 - ty) * ((1 - tx) * v00 + tx * v10) +
+                             ty * ((1 - tx) * v01 + tx * v11);
+                computed_[i] = 1;
+            }
+        }
+    }
+
+    const Sampler<Kernel>& sampler_;
+    float* values_;
+    char* computed_;
+    std::uint64_t& iterated_;
+};
+} // namespace
+
+CpuRenderer::CpuRenderer(unsigned threads) : threads_(threadCount(threads))
+{
+}
+
+// Out receives the pixels of span from its first one on.
+template <typename Kernel, bool TrackDerivative>
+static void
+renderSpan(const Sampler<Kernel>& sampler, const PixelRect& span, float* out)
+{
+    const auto& params = sampler.params;
+    const auto y = sampler.compY(span.y0 + 0.5);
+    for (int col = span.x0; col <= span.x1; col++) {
+        const auto e = sampler.template escapeAt<TrackDerivative>(
+            sampler.compX(col + 0.5), y);
+        out[col - span.x0] =
+            TrackDerivative
+                ? distanceValue(e, params.iterations, sampler.pixelSize)
+                : escapeTimeValue(e, params.iterations);
+    }
+}
+
+// Pixels smaller than this many fixed point steps are refused, the rounding
+// of their centers would show.
+static constexpr double MIN_FIXED_PIXEL = 16.0;
+
+// Like renderSpan in fixed point. Pixel centers are offset from the view
+// center in fixed point too, so neighbouring pixels stay apart where doubles
+// would round them to the same point.
+template <typename Kernel>
+static void renderSpanFixed(const Sampler<Kernel>& sampler,
+                            const PixelRect& span,
+                            float* out)
+{
+    const auto& params = sampler.params;
+    const auto& res = params.viewResolution;
+    // Pixel centers are odd multiples of half a pixel from the view center.
+    // Each offset is computed in double and rounded once, so the error stays
+    // under one step instead of growing with the column.
+    const auto halfX = params.compResolution.x / res.x / 2;
+    const auto halfY = params.compResolution.y / res.y / 2;
+    const auto centerX = toFixed(params.compCenter.x);
+    const auto y = toFixed(params.compCenter.y) +
+                   toFixed((2.0 * span.y0 + 1 - res.y) * halfY);
+    const auto seedX = toFixed(params.seed.x);
+    const auto seedY = toFixed(params.seed.y);
+
+    // One pixel at a time, glFractals_kernel_bench measured interleaving
+    // them with escapeFixedLanes slower.
+    for (int col = span.x0; col <= span.x1; col++) {
+        const auto x = centerX + toFixed((2.0 * col + 1 - res.x) * halfX);
+        auto e = Escape<double>();
+        e.iterations = escapeFixed<Kernel>(x,
+                                           y,
+                                           sampler.julia ? seedX : x,
+                                           sampler.julia ? seedY : y,
+                                           params.iterations);
+        out[col - span.x0] = escapeTimeValue(e, params.iterations);
+    }
+}
+
+void CpuRenderer::render(const FractalParams& params,
+                         std::vector<float>& values)
+{
+    const auto& res = params.viewResolution;
+    const auto width = std::max(0, res.x);
+    const auto height = std::max(0, res.y);
+    values.resize(static_cast<std::size_t>(width) * height);
+
+    // Only the pixels that aren't mirror copies get rendered, around the
+    // slightly moved center the copies line up with.
+    const auto symmetry = Symmetry(params, symmetry_);
+    auto uniqueParams = params;
+    uniqueParams.compCenter = symmetry.compCenter();
+    fixedPoint_ = arithmetic_ == Arithmetic::FIXED_POINT &&
+                  fixedPointCovers(uniqueParams);
+    dispatchFormula(params.formula, [&](auto kernel) {
+        renderFormula<decltype(kernel)>(uniqueParams, symmetry, values);
+    });
+
+    symmetry.mirror(values.data());
+    renderedPixels_ = values.size();
+    mirroredPixels_ = symmetry.copiedPixels();
+}
+
+template <typename Kernel>
+void CpuRenderer::renderFormula(const FractalParams& params,
+                                const Symmetry& symmetry,
+                                std::vector<float>& values)
+{
+    // Disk filling relies on the distance estimate being a proven bound.
+    if (method_ == Method::DISK_FILL && params.formula.holomorphic()) {
+        const auto sampler = Sampler<Kernel>(params);
+        computed_.assign(values.size(), 0);
+
+        std::vector<PixelRect> tiles;
+        for (const auto& rect : symmetry.uniqueRects()) {
+            for (int y0 = rect.y0; y0 <= rect.y1; y0 += FILL_TILE_SIZE) {
+                for (int x0 = rect.x0; x0 <= rect.x1; x0 += FILL_TILE_SIZE) {
+                    tiles.push_back(
+                        {x0,
+                         y0,
+                         std::min(x0 + FILL_TILE_SIZE - 1, rect.x1),
+                         std::min(y0 + FILL_TILE_SIZE - 1, rect.y1)});
+                }
+            }
+        }
+
+        std::atomic<std::size_t> nextTile(0);
+        std::atomic<std::uint64_t> iterated(0);
+        runThreads(threads_, [&](unsigned) {
+            std::uint64_t tileIterated = 0;
+            auto filler = DiskFiller<Kernel>(
+                sampler, values.data(), computed_.data(), tileIterated);
+            for (auto t = nextTile++; t < tiles.size(); t = nextTile++) {
+                filler.fill(tiles[t].x0, tiles[t].y0, tiles[t].x1, tiles[t].y1);
+            }
+            iterated += tileIterated;
+        });
+        iteratedPixels_ = iterated;
+    }
+    else {
+        std::vector<PixelRect> spans;
+        for (const auto& rect : symmetry.uniqueRects()) {
+            for (int y = rect.y0; y <= rect.y1; y++) {
+                spans.push_back({rect.x0, y, rect.x1, y});
+            }
+        }
+        const auto& res = params.viewResolution;
+        renderSpans<Kernel>(
+            params, spans, {0, 0, res.x - 1, res.y - 1}, values.data());
+        iteratedPixels_ = values.size() - symmetry.copiedPixels();
+    }
+}
+
+void CpuRenderer::renderTile(const FractalParams& params,
+                             const PixelRect& tile,
+                             std::vector<float>& values)
+{
+    const auto width = std::max(0, tile.x1 - tile.x0 + 1);
+    const auto height = std::max(0, tile.y1 - tile.y0 + 1);
+    values.resize(static_cast<std::size_t>(width) * height);
+
+    // Decided for the whole frame, so all of its tiles agree.
+    fixedPoint_ = arithmetic_ == Arithmetic::FIXED_POINT &&
+                  fixedPointCovers(params);
+
+    std::vector<PixelRect> spans;
+    for (int y = tile.y0; y <= tile.y1; y++) {
+        spans.push_back({tile.x0, y, tile.x1, y});
+    }
+    dispatchFormula(params.formula, [&](auto kernel) {
+        renderSpans<decltype(kernel)>(params, spans, tile, values.data());
+    });
+
+    renderedPixels_ = values.size();
+    iteratedPixels_ = values.size();
+    mirroredPixels_ = 0;
+}
+
+template <typename Kernel>
+void CpuRenderer::renderSpans(const FractalParams& params,
+                              const std::vector<PixelRect>& spans,
+                              const PixelRect& target,
+                              float* values)
+{
+    const auto sampler = Sampler<Kernel>(params);
+    const auto spanFunc =
+        fixedPoint_ ? renderSpanFixed<Kernel>
+        : (params.mode == RenderMode::DISTANCE_ESTIMATE)
+            ? renderSpan<Kernel, true>
+            : renderSpan<Kernel, false>;
+    const auto width = static_cast<std::size_t>(target.x1 - target.x0 + 1);
+
+    // Rows are handed out one at a time so the threads finish together even
+    // though rows through the set take much longer.
+    std::atomic<std::size_t> nextSpan(0);
+    runThreads(threads_, [&](unsigned) {
+        for (auto i = nextSpan++; i < spans.size(); i = nextSpan++) {
+            const auto& span = spans[i];
+            const auto row = static_cast<std::size_t>(span.y0 - target.y0);
+            spanFunc(
+                sampler, span, values + row * width + (span.x0 - target.x0));
+        }
+    });
+}
+
+void CpuRenderer::setMethod(Method method) { method_ = method; }
+
+void CpuRenderer::setSymmetry(bool enabled) { symmetry_ = enabled; }
+
+void CpuRenderer::setArithmetic(Arithmetic arithmetic)
+{
+    arithmetic_ = arithmetic;
+}
+
+auto CpuRenderer::arithmetic() const -> Arithmetic { return arithmetic_; }
+
+auto CpuRenderer::fixedPointCovers(const FractalParams& params) const -> bool
+{
+    if (params.mode != RenderMode::ESCAPE_TIME ||
+        method_ != Method::PER_PIXEL || !fixedPointFormula(params.formula)) {
+        return false;
+    }
+    if (params.type == FractalType::JULIA &&
+        !fixedPointFits(params.seed.x, params.seed.y)) {
+        return false;
+    }
+    const auto& res = params.viewResolution;
+    const auto pixel = std::min(params.compResolution.x / std::max(1, res.x),
+                                params.compResolution.y / std::max(1, res.y));
+    if (pixel < MIN_FIXED_PIXEL * fromFixed(1)) {
+        return false;
+    }
+    // The disk is convex, so the view is inside when its corners are.
+    const auto halfX = params.compResolution.x / 2;
+    const auto halfY = params.compResolution.y / 2;
+    for (const auto sx : {-1.0, 1.0}) {
+        for (const auto sy : {-1.0, 1.0}) {
+            if (!fixedPointFits(params.compCenter.x + sx * halfX,
+                                params.compCenter.y + sy * halfY)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto CpuRenderer::method() const -> Method { return method_; }
+
+auto CpuRenderer::threads() const -> unsigned { return threads_; }
+
+void CpuRenderer::stateLines(HudText& hud) const
+{
+    if (arithmetic_ == Arithmetic::FIXED_POINT) {
+        hud.addLine(fixedPoint_ || renderedPixels_ == 0
+                        ? "arithmetic: Q4.60 fixed point"
+                        : "arithmetic: double, out of fixed point's reach");
+    }
+    if (renderedPixels_ == 0) {
+        hud.addLine("cpu threads: %u", threads_);
+        return;
+    }
+    hud.addLine("cpu threads: %u, iterated %llu%%, mirrored %llu%% of pixels",
+                threads_,
+                static_cast<unsigned long long>(iteratedPixels_ * 100 /
+                                                renderedPixels_),
+                static_cast<unsigned long long>(mirroredPixels_ * 100 /
+                                                renderedPixels_));
+}
+
+} // namespace glFractals
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "FractalParams.hpp"
+#include "HudText.hpp"
+#include "Symmetry.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// Renders fractals on the CPU in double precision or fixed point, spread over
+// all cores.
+class CpuRenderer {
+public:
+    enum class Method {
+        // Iterates every pixel.
+        PER_PIXEL,
+        // Iterates distance estimates at seed points and interpolates the
+        // smooth iteration count over disks proven to be outside the set.
+        DISK_FILL
+    };
+
+    enum class Arithmetic {
+        DOUBLE,
+        // Q4.60 fixed point, see FixedPoint.hpp. Gives the same pixels on
+        // every machine and resolves views about 256 times deeper than
+        // doubles, down to pixels of 16 fixed point steps, but only for the
+        // escape time of quadratic formulas per pixel, within the escape
+        // radius. Other frames fall back to double.
+        FIXED_POINT
+    };
+
+    // A thread count of 0 uses every hardware thread.
+    explicit CpuRenderer(unsigned threads = 0);
+
+    // Fills values with one unit interval value per pixel, the same values
+    // Iterations.fs writes for the GLSL path. Rows go bottom up like OpenGL.
+    void render(const FractalParams& params, std::vector<float>& values);
+    // Fills values with the pixels of one tile of the frame params
+    // describes, rows bottom up, the same values render gives them without
+    // symmetry. Always iterates every pixel, whatever the method.
+    void renderTile(const FractalParams& params,
+                    const PixelRect& tile,
+                    std::vector<float>& values);
+
+    void setMethod(Method method);
+    auto method() const -> Method;
+
+    void setArithmetic(Arithmetic arithmetic);
+    auto arithmetic() const -> Arithmetic;
+    // Whether fixed point can render the frame params describes, or
+    // FIXED_POINT falls back to double for it.
+    auto fixedPointCovers(const FractalParams& params) const -> bool;
+
+    // Only compute the unique part of frames covering a symmetric region.
+    void setSymmetry(bool enabled);
+
+    auto threads() const -> unsigned;
+
+    // Adds statistics of the last render to the HUD.
+    void stateLines(HudText& hud) const;
+
+private:
+    unsigned threads_ = 1;
+    Method method_ = Method::PER_PIXEL;
+    bool symmetry_ = true;
+    Arithmetic arithmetic_ = Arithmetic::DOUBLE;
+    // Whether the last render could use fixed point.
+    bool fixedPoint_ = false;
+
+    // Marks the pixels disk filling already has a value for.
+    std::vector<char> computed_;
+
+    std::uint64_t renderedPixels_ = 0;
+    std::uint64_t iteratedPixels_ = 0;
+    std::uint64_t mirroredPixels_ = 0;
+
+    // Renders the pixels symmetry doesn't copy with the kernel of the
+    // formula, see dispatchFormula.
+    template <typename Kernel>
+    void renderFormula(const FractalParams& params,
+                       const Symmetry& symmetry,
+                       std::vector<float>& values);
+    // Iterates every pixel of spans into values, which hold the pixels of
+    // target row by row.
+    template <typename Kernel>
+    void renderSpans(const FractalParams& params,
+                     const std::vector<PixelRect>& spans,
+                     const PixelRect& target,
+                     float* values);
+};
+
+} // namespace glFractals
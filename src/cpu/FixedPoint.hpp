@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Formula.hpp"
+#include "Kernels.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+namespace glFractals {
+
+// Q4.60 signed fixed point: 60 fraction bits cover [-8, 8) in steps of
+// 2^-60, about 8.7e-19, where a double near 1 steps by 2.2e-16. Integer
+// arithmetic gives the same bits on every machine and compiler.
+using Fixed = std::int64_t;
+
+static constexpr int FIXED_FRACTION_BITS = 60;
+static constexpr Fixed FIXED_ONE = Fixed(1) << FIXED_FRACTION_BITS;
+
+// Rounds to the nearest representable value, which must be within range.
+inline auto toFixed(double value) -> Fixed
+{
+    return static_cast<Fixed>(
+        std::llround(std::ldexp(value, FIXED_FRACTION_BITS)));
+}
+
+inline auto fromFixed(Fixed value) -> double
+{
+    return std::ldexp(static_cast<double>(value), -FIXED_FRACTION_BITS);
+}
+
+// The product rounded toward minus infinity.
+inline auto fixedMul(Fixed a, Fixed b) -> Fixed
+{
+#ifdef __SIZEOF_INT128__
+    return static_cast<Fixed>((static_cast<__int128>(a) * b) >>
+                              FIXED_FRACTION_BITS);
+#else
+    // The full 128 bit product from 32 bit halves, then the same shift.
+    const auto negative = (a < 0) != (b < 0);
+    const auto ua = static_cast<std::uint64_t>(a < 0 ? -a : a);
+    const auto ub = static_cast<std::uint64_t>(b < 0 ? -b : b);
+    const auto lo = (ua & 0xffffffff) * (ub & 0xffffffff);
+    const auto mid1 = (ua >> 32) * (ub & 0xffffffff);
+    const auto mid2 = (ua & 0xffffffff) * (ub >> 32);
+    const auto carry =
+        (lo >> 32) + (mid1 & 0xffffffff) + (mid2 & 0xffffffff);
+    auto low = (lo & 0xffffffff) | (carry << 32);
+    auto high = (ua >> 32) * (ub >> 32) + (mid1 >> 32) + (mid2 >> 32) +
+                (carry >> 32);
+    if (negative) {
+        // Two's complement of the 128 bit value.
+        low = ~low + 1;
+        high = ~high + (low == 0 ? 1 : 0);
+    }
+    return static_cast<Fixed>((high << (64 - FIXED_FRACTION_BITS)) |
+                              (low >> FIXED_FRACTION_BITS));
+#endif
+}
+
+// Fixed point only iterates quadratic formulas, higher powers leave the
+// range before they can escape.
+inline auto fixedPointFormula(const Formula& formula) -> bool
+{
+    return formula.power == 2;
+}
+
+// Starting points and seeds must lie within the escape radius. Then |z| and
+// |c| are at most 2 whenever z is squared, and fold(z)^2 + c stays below 6.
+inline auto fixedPointFits(double x, double y) -> bool
+{
+    return x * x + y * y <= ESCAPE_RADIUS_SQ;
+}
+
+// One iteration of z = fold(z)^2 + c. Returns true once z escaped.
+template <typename Kernel>
+inline auto fixedStep(Fixed& zx, Fixed& zy, Fixed cx, Fixed cy) -> bool
+{
+    static constexpr Fixed TWO = 2 * FIXED_ONE;
+    static constexpr std::uint64_t FOUR = 4 * FIXED_ONE;
+
+    auto wx = zx;
+    auto wy = zy;
+    Kernel::fold(wx, wy);
+
+    zx = fixedMul(wx, wx) - fixedMul(wy, wy) + cx;
+    zy = 2 * fixedMul(wx, wy) + cy;
+
+    // Squares of components up to 2 are at most 4, so their sum still fits
+    // unsigned.
+    if (zx > TWO || zx < -TWO || zy > TWO || zy < -TWO) {
+        return true;
+    }
+    return static_cast<std::uint64_t>(fixedMul(zx, zx)) +
+               static_cast<std::uint64_t>(fixedMul(zy, zy)) >
+           FOUR;
+}
+
+// The escape iteration of one point, counted the same way as escape() so
+// escapeTimeValue colors both alike. Equals iterations for points that
+// didn't escape.
+template <typename Kernel = QuadraticKernel>
+auto escapeFixed(Fixed zx, Fixed zy, Fixed cx, Fixed cy, int iterations)
+    -> int
+{
+    int i;
+    for (i = 1; i < iterations; i++) {
+        if (fixedStep<Kernel>(zx, zy, cx, cy)) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Iterates the points 0 to count - 1 Lanes at a time. The integer multiplies
+// have no SIMD form, so the lanes are interleaved instead to hide the latency
+// of one multiply behind the others. A lane takes the next point as soon as
+// its own escapes, so no lane idles while others finish. Whether this beats
+// escapeFixed depends on the machine, glFractals_kernel_bench compares both.
+// load(index, zx, zy, cx, cy) sets up a point, store(index, iterations)
+// receives its escape iteration.
+template <typename Kernel, int Lanes, typename Load, typename Store>
+void escapeFixedLanes(int count, int iterations, Load load, Store store)
+{
+    Fixed zx[Lanes];
+    Fixed zy[Lanes];
+    Fixed cx[Lanes];
+    Fixed cy[Lanes];
+    int iteration[Lanes];
+    // -1 for lanes without a point.
+    int index[Lanes];
+
+    auto next = 0;
+    auto active = 0;
+    for (int l = 0; l < Lanes; l++) {
+        index[l] = next < count ? next++ : -1;
+        if (index[l] >= 0) {
+            load(index[l], zx[l], zy[l], cx[l], cy[l]);
+            iteration[l] = 1;
+            active++;
+        }
+    }
+
+    while (active > 0) {
+        for (int l = 0; l < Lanes; l++) {
+            if (index[l] < 0) {
+                continue;
+            }
+            if (iteration[l] < iterations &&
+                !fixedStep<Kernel>(zx[l], zy[l], cx[l], cy[l])) {
+                iteration[l]++;
+                continue;
+            }
+
+            store(index[l], iteration[l]);
+            index[l] = next < count ? next++ : -1;
+            if (index[l] >= 0) {
+                load(index[l], zx[l], zy[l], cx[l], cy[l]);
+                iteration[l] = 1;
+            }
+            else {
+                active--;
+            }
+        }
+    }
+}
+
+} // namespace glFractals
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "Formula.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace glFractals {
+
+// Squared escape radius of the plain escape time loop, same as the shaders.
+static constexpr double ESCAPE_RADIUS_SQ = 4.0;
+// The distance estimate converges with the radius, so escape much later.
+static constexpr double DE_ESCAPE_RADIUS_SQ = 1.0e4;
+
+// Result of iterating a single point.
+template <typename Real>
+struct Escape {
+    // Equals the iteration limit when the point didn't escape.
+    int iterations = 0;
+    // Continuous iteration count. Only valid for escaped points.
+    Real smooth = 0;
+    // Lower bound of the distance to the set in complex units. Only valid for
+    // escaped points when the derivative is tracked.
+    Real distance = 0;
+};
+
+// Sets (rx, ry) to (x + iy)^N, unrolled into complex multiplies by repeated
+// squaring at compile time. formulaShaderSource emits the same chain.
+template <int N>
+struct ComplexPow {
+    template <typename Real>
+    static void apply(Real x, Real y, Real& rx, Real& ry)
+    {
+        Real hx;
+        Real hy;
+        ComplexPow<N / 2>::apply(x, y, hx, hy);
+        const Real sx = hx * hx - hy * hy;
+        const Real sy = 2 * hx * hy;
+        if (N % 2 == 0) {
+            rx = sx;
+            ry = sy;
+        }
+        else {
+            rx = sx * x - sy * y;
+            ry = sx * y + sy * x;
+        }
+    }
+};
+
+template <>
+struct ComplexPow<1> {
+    template <typename Real>
+    static void apply(Real x, Real y, Real& rx, Real& ry)
+    {
+        rx = x;
+        ry = y;
+    }
+};
+
+// Compile time version of Formula, see dispatchFormula.
+template <int Power, Fold FoldType>
+struct FormulaKernel {
+    static constexpr int POWER = Power;
+    static constexpr Fold FOLD = FoldType;
+
+    template <typename Real>
+    static void fold(Real& x, Real& y)
+    {
+        using std::abs;
+        if (FoldType == Fold::ABS) {
+            x = abs(x);
+            y = abs(y);
+        }
+        else if (FoldType == Fold::CONJUGATE) {
+            y = -y;
+        }
+    }
+
+    // The folds are reflections, so their derivative reflects dz the same
+    // way. Uses z before folding.
+    template <typename Real>
+    static void foldDerivative(Real zx, Real zy, Real& dx, Real& dy)
+    {
+        if (FoldType == Fold::ABS) {
+            dx = (zx < 0) ? -dx : dx;
+            dy = (zy < 0) ? -dy : dy;
+        }
+        else if (FoldType == Fold::CONJUGATE) {
+            dy = -dy;
+        }
+    }
+};
+
+using QuadraticKernel = FormulaKernel<2, Fold::NONE>;
+
+namespace detail {
+template <int Power>
+struct FormulaDispatch {
+    template <typename Func>
+    static void call(const Formula& formula, Func& func)
+    {
+        if (formula.power != Power) {
+            FormulaDispatch<Power + 1>::call(formula, func);
+            return;
+        }
+        switch (formula.fold) {
+            case Fold::ABS:
+                func(FormulaKernel<Power, Fold::ABS>());
+                break;
+            case Fold::CONJUGATE:
+                func(FormulaKernel<Power, Fold::CONJUGATE>());
+                break;
+            default:
+                func(FormulaKernel<Power, Fold::NONE>());
+                break;
+        }
+    }
+};
+
+template <>
+struct FormulaDispatch<MAX_FORMULA_POWER + 1> {
+    template <typename Func>
+    static void call(const Formula&, Func&)
+    {
+        throw std::runtime_error("formula power out of range");
+    }
+};
+} // namespace detail
+
+// Calls func with the FormulaKernel matching formula, so every kernel is
+// specialized for its power and fold at compile time.
+template <typename Func>
+void dispatchFormula(const Formula& formula, Func func)
+{
+    detail::FormulaDispatch<2>::call(formula, func);
+}
+
+// Iterates z = fold(z)^Power + c the same way Mandelbrot.fs and Julia.fs do.
+// When TrackDerivative is set, dz = Power * fold(z)^(Power - 1) * fold'(dz) +
+// dc is iterated alongside z, where dc is 1 for the Mandelbrot set (c follows
+// the pixel) and 0 for Julia sets.
+template <typename Real,
+          bool TrackDerivative,
+          typename Kernel = QuadraticKernel>
+auto escape(Real zx, Real zy, Real cx, Real cy, Real dc, int iterations)
+    -> Escape<Real>
+{
+    const auto radiusSq =
+        static_cast<Real>(TrackDerivative ? DE_ESCAPE_RADIUS_SQ
+                                          : ESCAPE_RADIUS_SQ);
+    Real dzx = 1;
+    Real dzy = 0;
+
+    auto result = Escape<Real>();
+    int i;
+    for (i = 1; i < iterations; i++) {
+        Real wx = zx;
+        Real wy = zy;
+        Kernel::fold(wx, wy);
+
+        Real x;
+        Real y;
+        if (TrackDerivative) {
+            // Shares w^(Power - 1) between z and dz.
+            Real px;
+            Real py;
+            ComplexPow<Kernel::POWER - 1>::apply(wx, wy, px, py);
+            x = px * wx - py * wy + cx;
+            y = px * wy + py * wx + cy;
+
+            Kernel::foldDerivative(zx, zy, dzx, dzy);
+            const Real dx = Kernel::POWER * (px * dzx - py * dzy) + dc;
+            const Real dy = Kernel::POWER * (px * dzy + py * dzx);
+            dzx = dx;
+            dzy = dy;
+        }
+        else {
+            ComplexPow<Kernel::POWER>::apply(wx, wy, x, y);
+            x += cx;
+            y += cy;
+        }
+
+        const Real magSq = x * x + y * y;
+        if (magSq > radiusSq) {
+            using std::log;
+            using std::sqrt;
+            // Normalized to the plain escape radius so the count lines up
+            // with the escape time bands whatever radius we iterate to.
+            result.smooth = i + 1 -
+                            log(log(magSq) / log(Real(ESCAPE_RADIUS_SQ))) /
+                                log(Real(Kernel::POWER));
+            if (TrackDerivative) {
+                // Koebe 1/4 theorem: the real distance is between a quarter
+                // and the full 2|z|log|z|/|dz|.
+                const Real mag = sqrt(magSq);
+                result.distance =
+                    Real(0.5) * mag * log(mag) / sqrt(dzx * dzx + dzy * dzy);
+            }
+            break;
+        }
+
+        zx = x;
+        zy = y;
+    }
+    result.iterations = i;
+    return result;
+}
+
+// Maps the escape of a point to the unit interval value the palette colors.
+// Keep in sync with the shaders.
+template <typename Real>
+auto escapeTimeValue(const Escape<Real>& e, int iterations) -> float
+{
+    return static_cast<float>(e.iterations) / static_cast<float>(iterations);
+}
+
+template <typename Real>
+auto distanceValue(const Escape<Real>& e, int iterations, Real pixelSize)
+    -> float
+{
+    if (e.iterations >= iterations) {
+        return 1.0f;
+    }
+    // The derivative overflows on long orbits next to the set.
+    const auto distance = std::isfinite(e.distance) ? e.distance : Real(0);
+    // Brightest right at the boundary, fading out over a few pixels.
+    return static_cast<float>(0.3 / (1.0 + 0.25 * distance / pixelSize));
+}
+
+} // namespace glFractals
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+namespace glFractals {
+
+// The colors of Palette.fs, for images colored without a GPU. Matches the
+// shader up to the rounding of the GPU's float math.
+
+// Assumes unit interval, based on cubic hermite splines.
+inline auto cubicInterp(float i, float p0, float p1, float m0, float m1)
+    -> float
+{
+    return (i * i * i * (2 * p0 + m0 - 2 * p1 + m1)) +
+           (i * i * (-3 * p0 - 2 * m0 + 3 * p1 - m1)) + (i * m0) + p0;
+}
+
+// Maps an iteration value in the unit interval to 8 bit RGB, converted the
+// way OpenGL stores normalized colors.
+inline auto paletteColor(float value) -> std::array<unsigned char, 3>
+{
+    const float rgb[3] = {cubicInterp(value, 0, 0, 1, -6),
+                          cubicInterp(value, 0, 0, 4, -3),
+                          cubicInterp(value, 0.1f, 0, 6, 0)};
+    auto color = std::array<unsigned char, 3>();
+    for (int c = 0; c < 3; c++) {
+        const auto clamped = std::min(std::max(rgb[c], 0.0f), 1.0f);
+        color[c] = static_cast<unsigned char>(clamped * 255.0f + 0.5f);
+    }
+    return color;
+}
+
+} // namespace glFractals
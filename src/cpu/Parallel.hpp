@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace glFractals {
+
+// A requested thread count of 0 uses every hardware thread.
+inline auto threadCount(unsigned requested) -> unsigned
+{
+    return requested != 0 ? requested
+                          : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs work(thread) on threads threads, including the calling one as thread 0,
+// and returns when all of them are done.
+template <typename Work>
+void runThreads(unsigned threads, Work work)
+{
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++) {
+        workers.emplace_back(work, t);
+    }
+    work(0u);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace glFractals
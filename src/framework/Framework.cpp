@@ -2,6 +2,7 @@
 
 #include "CloseListener.hpp"
 #include "Event.hpp"
+#include "InputLog.hpp"
 #include "KeyListener.hpp"
 #include "MouseListener.hpp"
 #include "ResolutionChangeListener.hpp"
@@ -23,7 +24,7 @@ static constexpr auto GL_VER_MAJOR = 3;
 static constexpr auto GL_VER_MINOR = 3;
 static constexpr auto PROJECT_NAME = "glFractals";
 
-Framework::Framework(int winWidth, int winHeight)
+Framework::Framework(int winWidth, int winHeight, bool debugContext)
     : winWidth_(winWidth), winHeight_(winHeight)
 {
     if (GLFW_FALSE == glfwInit()) {
@@ -34,6 +35,8 @@ Framework::Framework(int winWidth, int winHeight)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, GL_VER_MINOR);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   debugContext ? GLFW_TRUE : GLFW_FALSE);
 
     window_ =
         glfwCreateWindow(winWidth, winHeight, PROJECT_NAME, nullptr, nullptr);
@@ -72,33 +75,62 @@ Framework::~Framework()
     winHeight_ = 0;
 }
 
+static_assert(Framework::NUM_KEYS > GLFW_KEY_LAST, "key map too small");
+static_assert(Framework::NUM_MOUSE_BUTTONS > GLFW_MOUSE_BUTTON_LAST,
+              "mouse map too small");
+
+static auto buttonState(int action) -> ButtonState
+{
+    return (action == GLFW_PRESS)
+               ? ButtonState::PRESSED
+               : (action == GLFW_RELEASE) ? ButtonState::RELEASED
+                                          : ButtonState::REPEATED;
+}
+
 void Framework::registerKeyListener(KeyListener& listener)
 {
     keyListeners_.push_back(&listener);
 }
 
+void Framework::registerMouseListener(MouseListener& listener)
+{
+    mouseListeners_.push_back(&listener);
+}
+
+void Framework::registerCloseListener(CloseListener& listener)
+{
+    closeListeners_.push_back(&listener);
+}
+
+void Framework::registerResolutionChangeListener(
+    ResolutionChangeListener& listener)
+{
+    resChangeListeners_.push_back(&listener);
+}
+
+void Framework::queueEvent(const InputEvent& event)
+{
+    if (!inputQueue_.push(event)) {
+        droppedEvents_++;
+    }
+}
+
 void Framework::keyCallback(
     GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     auto framework = static_cast<Framework*>(glfwGetWindowUserPointer(window));
     assert(framework != nullptr);
 
-    const auto state = (action == GLFW_PRESS)
-                           ? ButtonState::PRESSED
-                           : (action == GLFW_RELEASE) ? ButtonState::RELEASED
-                                                      : ButtonState::REPEATED;
-
-    auto find_i = framework->keyMap_.find(key);
-    if (find_i != framework->keyMap_.end()) {
-        for (auto listener : framework->keyListeners_) {
-            listener->notifyEvent(find_i->second, state);
-        }
+    if (key < 0 || key >= NUM_KEYS || framework->keyMap_[key] == Event::NONE) {
+        return;
     }
-}
 
-void Framework::registerMouseListener(MouseListener& listener)
-{
-    mouseListeners_.push_back(&listener);
+    auto event = InputEvent();
+    event.kind = InputEvent::Kind::KEY;
+    event.event = framework->keyMap_[key];
+    event.state = buttonState(action);
+    event.time = framework->time();
+    framework->queueEvent(event);
 }
 
 void Framework::mouseCursorCallback(GLFWwindow* window,
@@ -108,10 +140,13 @@ void Framework::mouseCursorCallback(GLFWwindow* window,
     auto framework = static_cast<Framework*>(glfwGetWindowUserPointer(window));
     assert(framework != nullptr);
 
-    for (auto listener : framework->mouseListeners_) {
-        listener->notifyMouse(
-            xpos, ypos, 0, 0, Event::NONE, ButtonState::RELEASED);
-    }
+    auto event = InputEvent();
+    event.kind = InputEvent::Kind::CURSOR;
+    event.event = Event::NONE;
+    event.time = framework->time();
+    event.x = xpos;
+    event.y = ypos;
+    framework->queueEvent(event);
 }
 
 void Framework::mouseButtonCallback(GLFWwindow* window,
@@ -122,20 +157,22 @@ void Framework::mouseButtonCallback(GLFWwindow* window,
     auto framework = static_cast<Framework*>(glfwGetWindowUserPointer(window));
     assert(framework != nullptr);
 
-    const auto state = (action == GLFW_PRESS)
-                           ? ButtonState::PRESSED
-                           : (action == GLFW_RELEASE) ? ButtonState::RELEASED
-                                                      : ButtonState::REPEATED;
+    if (key < 0 || key >= NUM_MOUSE_BUTTONS ||
+        framework->mouseMap_[key] == Event::NONE) {
+        return;
+    }
 
     double xpos, ypos;
     glfwGetCursorPos(window, &xpos, &ypos);
 
-    auto find_i = framework->mouseMap_.find(key);
-    if (find_i != framework->mouseMap_.end()) {
-        for (auto listener : framework->mouseListeners_) {
-            listener->notifyMouse(xpos, ypos, 0, 0, find_i->second, state);
-        }
-    }
+    auto event = InputEvent();
+    event.kind = InputEvent::Kind::MOUSE_BUTTON;
+    event.event = framework->mouseMap_[key];
+    event.state = buttonState(action);
+    event.time = framework->time();
+    event.x = xpos;
+    event.y = ypos;
+    framework->queueEvent(event);
 }
 
 void Framework::mouseScrollCallback(GLFWwindow* window,
@@ -148,60 +185,150 @@ void Framework::mouseScrollCallback(GLFWwindow* window,
     double xpos, ypos;
     glfwGetCursorPos(window, &xpos, &ypos);
 
-    for (auto listener : framework->mouseListeners_) {
-        listener->notifyMouse(
-            xpos, ypos, xscroll, yscroll, Event::NONE, ButtonState::RELEASED);
-        ;
-    }
+    auto event = InputEvent();
+    event.kind = InputEvent::Kind::SCROLL;
+    event.event = Event::NONE;
+    event.time = framework->time();
+    event.x = xpos;
+    event.y = ypos;
+    event.scrollX = xscroll;
+    event.scrollY = yscroll;
+    framework->queueEvent(event);
 }
 
-void Framework::registerCloseListener(CloseListener& listener)
+void Framework::closeCallback(GLFWwindow* window)
 {
-    closeListeners_.push_back(&listener);
+    auto framework = static_cast<Framework*>(glfwGetWindowUserPointer(window));
+    assert(framework != nullptr);
+
+    auto event = InputEvent();
+    event.kind = InputEvent::Kind::CLOSE;
+    event.event = Event::NONE;
+    event.time = framework->time();
+    framework->queueEvent(event);
 }
 
-void Framework::closeCallback(GLFWwindow* window)
+void Framework::resolutionChangeCallback(GLFWwindow* window,
+                                         int width,
+                                         int height)
 {
     auto framework = static_cast<Framework*>(glfwGetWindowUserPointer(window));
     assert(framework != nullptr);
 
-    for (auto listener : framework->closeListeners_) {
-        auto request = listener->notifyClose();
-        if (request == false) {
-            break;
+    auto event = InputEvent();
+    event.kind = InputEvent::Kind::RESIZE;
+    event.event = Event::NONE;
+    event.time = framework->time();
+    event.x = width;
+    event.y = height;
+    framework->queueEvent(event);
+}
+
+// Only the end state of a run of moves or resizes matters, and the zoom of a
+// run of scrolls is the zoom of their sum. Key and button events are never
+// merged, so presses and releases keep their order.
+static auto mergeable(const InputEvent& event, const InputEvent& next) -> bool
+{
+    return event.kind == next.kind && (event.kind == InputEvent::Kind::CURSOR ||
+                                       event.kind == InputEvent::Kind::SCROLL ||
+                                       event.kind == InputEvent::Kind::RESIZE);
+}
+
+void Framework::dispatchEvents()
+{
+    auto event = InputEvent();
+    auto next = InputEvent();
+    while (inputQueue_.pop(event)) {
+        for (auto peeked = inputQueue_.peek();
+             peeked != nullptr && mergeable(event, *peeked);
+             peeked = inputQueue_.peek()) {
+            inputQueue_.pop(next);
+            next.scrollX += event.scrollX;
+            next.scrollY += event.scrollY;
+            event = next;
         }
+        dispatch(event);
     }
 }
 
-void Framework::registerResolutionChangeListener(
-    ResolutionChangeListener& listener)
+void Framework::recordEvents(InputRecorder* recorder) { recorder_ = recorder; }
+
+void Framework::replayEvents(InputReplay& replay, float time)
 {
-    resChangeListeners_.push_back(&listener);
+    auto event = InputEvent();
+    while (inputQueue_.pop(event)) {
+        if (event.kind == InputEvent::Kind::CLOSE) {
+            dispatch(event);
+        }
+    }
+    for (auto logged = replay.nextEvent(time); logged != nullptr;
+         logged = replay.nextEvent(time)) {
+        dispatch(*logged);
+    }
 }
 
-void Framework::resolutionChangeCallback(GLFWwindow* window,
-                                         int width,
-                                         int height)
+void Framework::dispatch(const InputEvent& event)
 {
-    auto framework = static_cast<Framework*>(glfwGetWindowUserPointer(window));
-    assert(framework != nullptr);
-
-    for (auto resObs : framework->resChangeListeners_) {
-        resObs->notifyResolution(width, height);
+    if (recorder_ != nullptr) {
+        recorder_->write(event);
+    }
+    switch (event.kind) {
+        case InputEvent::Kind::KEY:
+            for (auto listener : keyListeners_) {
+                listener->notifyEvent(event.event, event.state);
+            }
+            break;
+        case InputEvent::Kind::MOUSE_BUTTON:
+        case InputEvent::Kind::CURSOR:
+        case InputEvent::Kind::SCROLL:
+            for (auto listener : mouseListeners_) {
+                listener->notifyMouse(event.x,
+                                      event.y,
+                                      event.scrollX,
+                                      event.scrollY,
+                                      event.event,
+                                      event.state);
+            }
+            break;
+        case InputEvent::Kind::CLOSE:
+            for (auto listener : closeListeners_) {
+                if (listener->notifyClose() == false) {
+                    break;
+                }
+            }
+            break;
+        case InputEvent::Kind::RESIZE:
+            for (auto resObs : resChangeListeners_) {
+                resObs->notifyResolution(static_cast<int>(event.x),
+                                         static_cast<int>(event.y));
+            }
+            break;
     }
 }
 
 void Framework::mapButton(int platformKey, Event event)
 {
-    keyMap_.insert({platformKey, event});
+    assert(platformKey >= 0 && platformKey < NUM_KEYS);
+    keyMap_[platformKey] = event;
 }
 
 void Framework::mapMouseButton(int platformButton, Event event)
 {
-    mouseMap_.insert({platformButton, event});
+    assert(platformButton >= 0 && platformButton < NUM_MOUSE_BUTTONS);
+    mouseMap_[platformButton] = event;
 }
 
-void Framework::updateEvents() { glfwPollEvents(); }
+void Framework::updateEvents()
+{
+    glfwPollEvents();
+    dispatchEvents();
+}
+
+void Framework::waitEvents(double timeout) { glfwWaitEventsTimeout(timeout); }
+
+void Framework::makeContextCurrent() { glfwMakeContextCurrent(window_); }
+
+void Framework::releaseContext() { glfwMakeContextCurrent(nullptr); }
 
 void Framework::swapBuffers()
 {
@@ -217,4 +344,9 @@ auto Framework::resolution() const -> Point2D<int>
 
 auto Framework::time() const -> float { return glfwGetTime(); }
 
+auto Framework::droppedEvents() const -> std::uint64_t
+{
+    return droppedEvents_;
+}
+
 } // namespace glFractals
\ No newline at end of file
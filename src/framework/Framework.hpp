@@ -1,8 +1,11 @@
 #pragma once
 
 #include "Common.hpp"
+#include "InputEvent.hpp"
+#include "SpscRing.hpp"
 
-#include <unordered_map>
+#include <array>
+#include <cstdint>
 #include <vector>
 
 struct GLFWwindow;
@@ -10,6 +13,8 @@ struct GLFWwindow;
 namespace glFractals {
 
 enum class Event;
+class InputRecorder;
+class InputReplay;
 class KeyListener;
 class CloseListener;
 class MouseListener;
@@ -19,10 +24,15 @@ class Framework {
 public:
     static constexpr auto DEFAULT_WIN_WIDTH = 800;
     static constexpr auto DEFAULT_WIN_HEIGHT = 600;
+    // Bounds of the platform codes that can be mapped.
+    static constexpr int NUM_KEYS = 512;
+    static constexpr int NUM_MOUSE_BUTTONS = 8;
 
-    // Loads the Framework.
+    // Loads the Framework. A debug context makes the driver report messages,
+    // see enableDebugOutput.
     Framework(int winWidth = DEFAULT_WIN_WIDTH,
-              int winHeight = DEFAULT_WIN_HEIGHT);
+              int winHeight = DEFAULT_WIN_HEIGHT,
+              bool debugContext = false);
     ~Framework();
 
     void mapButton(int platformKey, Event event);
@@ -33,8 +43,29 @@ public:
     void registerMouseListener(MouseListener& listener);
     void registerResolutionChangeListener(ResolutionChangeListener& listener);
 
-    // Notifies all listeners.
+    // Notifies all listeners of the input since the last update.
     void updateEvents();
+    // Waits up to timeout seconds for input and queues it, without notifying
+    // anyone yet.
+    void waitEvents(double timeout);
+    // Notifies all listeners of the queued input. Consecutive cursor moves
+    // arrive as one, consecutive scrolls as their sum.
+    void dispatchEvents();
+
+    // Also writes every event handed to the listeners to recorder, null
+    // stops recording.
+    void recordEvents(InputRecorder* recorder);
+    // Hands the listeners the logged events from before time, up to the next
+    // logged update, instead of the queued input. Of that only closing the
+    // window gets through.
+    void replayEvents(InputReplay& replay, float time);
+
+    // The context is current on the thread that constructed the Framework.
+    // Release it there before making it current on another thread, which
+    // then calls swapBuffers. Events are always handled on the constructing
+    // thread.
+    void makeContextCurrent();
+    void releaseContext();
 
     void swapBuffers();
 
@@ -42,19 +73,32 @@ public:
 
     auto time() const -> float;
 
+    // Events lost because more arrived between two updates than fit the queue.
+    auto droppedEvents() const -> std::uint64_t;
+
 private:
     int winWidth_ = 0;
     int winHeight_ = 0;
     GLFWwindow* window_ = nullptr;
 
-    std::unordered_map<int, Event> keyMap_;
-    std::unordered_map<int, Event> mouseMap_;
+    // Indexed by platform code, NONE for unmapped ones.
+    std::array<Event, NUM_KEYS> keyMap_ = {};
+    std::array<Event, NUM_MOUSE_BUTTONS> mouseMap_ = {};
+
+    // Filled by the callbacks, drained by updateEvents.
+    static constexpr std::size_t INPUT_QUEUE_SIZE = 1024;
+    SpscRing<InputEvent, INPUT_QUEUE_SIZE> inputQueue_;
+    std::uint64_t droppedEvents_ = 0;
+    InputRecorder* recorder_ = nullptr;
 
     std::vector<KeyListener*> keyListeners_;
     std::vector<CloseListener*> closeListeners_;
     std::vector<MouseListener*> mouseListeners_;
     std::vector<ResolutionChangeListener*> resChangeListeners_;
 
+    void queueEvent(const InputEvent& event);
+    void dispatch(const InputEvent& event);
+
     static void keyCallback(
         GLFWwindow* window, int key, int scancode, int action, int mods);
     static void
@@ -0,0 +1,207 @@
+#include "HeadlessContext.hpp"
+
+#include "gl_utils.h"
+
+#include "glad/glad.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace glFractals {
+
+// Same version as the window, so the same shaders run.
+static constexpr EGLint GL_VER_MAJOR = 3;
+static constexpr EGLint GL_VER_MINOR = 3;
+
+static auto hasEglExtension(EGLDisplay display, const char* name) -> bool
+{
+    const auto extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (extensions == nullptr) {
+        return false;
+    }
+    // Names are separated by spaces, match whole names only.
+    const auto length = std::strlen(name);
+    for (auto found = std::strstr(extensions, name); found != nullptr;
+         found = std::strstr(found + length, name)) {
+        const auto startsName = found == extensions || found[-1] == ' ';
+        const auto endsName = found[length] == ' ' || found[length] == '\0';
+        if (startsName && endsName) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static auto openDisplay() -> EGLDisplay
+{
+    // The surfaceless platform needs neither X nor a GPU.
+    if (hasEglExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+        const auto getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay != nullptr) {
+            auto display = getPlatformDisplay(
+                EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY &&
+                eglInitialize(display, nullptr, nullptr)) {
+                return display;
+            }
+        }
+    }
+
+    auto display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY ||
+        !eglInitialize(display, nullptr, nullptr)) {
+        throw std::runtime_error("no EGL display");
+    }
+    return display;
+}
+
+HeadlessContext::HeadlessContext(int width, int height)
+    : width_(width), height_(height)
+{
+    if (width_ <= 0 || height_ <= 0) {
+        throw std::runtime_error("headless resolution must be positive");
+    }
+
+    auto display = openDisplay();
+    display_ = display;
+
+    const EGLint configAttribs[] = {EGL_SURFACE_TYPE,
+                                    EGL_PBUFFER_BIT,
+                                    EGL_RENDERABLE_TYPE,
+                                    EGL_OPENGL_BIT,
+                                    EGL_RED_SIZE,
+                                    8,
+                                    EGL_GREEN_SIZE,
+                                    8,
+                                    EGL_BLUE_SIZE,
+                                    8,
+                                    EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) ||
+        numConfigs == 0 || !eglBindAPI(EGL_OPENGL_API)) {
+        eglTerminate(display);
+        throw std::runtime_error("no EGL config for desktop OpenGL");
+    }
+
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                     GL_VER_MAJOR,
+                                     EGL_CONTEXT_MINOR_VERSION,
+                                     GL_VER_MINOR,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                     EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+    auto context =
+        eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        eglTerminate(display);
+        throw std::runtime_error("EGL context creation failed");
+    }
+    context_ = context;
+
+    // Everything is drawn into our own framebuffer, so a surface is only
+    // created for drivers that insist on one.
+    auto surface = EGL_NO_SURFACE;
+    if (!hasEglExtension(display, "EGL_KHR_surfaceless_context")) {
+        const EGLint surfaceAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+        surface_ = surface;
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        throw std::runtime_error("EGL make current failed");
+    }
+
+    if (!gladLoadGLLoader(getProcAddress)) {
+        throw std::runtime_error("glad load failed");
+    }
+
+    GL(glGenRenderbuffers(1, &colorBuffer_));
+    GL(glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer_));
+    GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_));
+
+    GL(glGenFramebuffers(1, &framebuffer_));
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_));
+    GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                                 GL_COLOR_ATTACHMENT0,
+                                 GL_RENDERBUFFER,
+                                 colorBuffer_));
+    GL(auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("headless framebuffer incomplete");
+    }
+
+    GL(glViewport(0, 0, width_, height_));
+    GL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+    GL(glClear(GL_COLOR_BUFFER_BIT));
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    GL(glDeleteFramebuffers(1, &framebuffer_));
+    GL(glDeleteRenderbuffers(1, &colorBuffer_));
+
+    auto display = static_cast<EGLDisplay>(display_);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface_ != nullptr) {
+        eglDestroySurface(display, static_cast<EGLSurface>(surface_));
+    }
+    eglDestroyContext(display, static_cast<EGLContext>(context_));
+    eglTerminate(display);
+}
+
+auto HeadlessContext::framebuffer() const -> std::uint32_t
+{
+    return framebuffer_;
+}
+
+auto HeadlessContext::resolution() const -> Point2D<int>
+{
+    return {width_, height_};
+}
+
+auto HeadlessContext::readPixels() const -> std::vector<unsigned char>
+{
+    const auto rowSize = static_cast<std::size_t>(width_) * 3;
+    std::vector<unsigned char> pixels(rowSize * height_);
+
+    GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_));
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GL(glReadPixels(
+        0, 0, width_, height_, GL_RGB, GL_UNSIGNED_BYTE, pixels.data()));
+
+    // GL rows are bottom up.
+    for (int y = 0; y < height_ / 2; y++) {
+        auto top = pixels.begin() + y * rowSize;
+        auto bottom = pixels.begin() + (height_ - 1 - y) * rowSize;
+        std::swap_ranges(top, top + rowSize, bottom);
+    }
+    return pixels;
+}
+
+void HeadlessContext::writePpm(const std::string& path) const
+{
+    const auto pixels = readPixels();
+
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width_ << " " << height_ << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    if (!file) {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
+
+auto HeadlessContext::getProcAddress(const char* name) -> void*
+{
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+
+} // namespace glFractals
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// An OpenGL context without a window or display, for batch jobs and tests.
+// Uses EGL on Mesa's surfaceless platform when available (llvmpipe works),
+// otherwise the default EGL display. Frames go into an offscreen framebuffer
+// of the given size, pass framebuffer() to the renderers as their target.
+class HeadlessContext {
+public:
+    // Creates the context, makes it current and loads the GL functions.
+    HeadlessContext(int width, int height);
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    auto framebuffer() const -> std::uint32_t;
+    auto resolution() const -> Point2D<int>;
+
+    // Waits for the frame and returns its pixels as RGB bytes, rows top down.
+    auto readPixels() const -> std::vector<unsigned char>;
+    // Writes the frame as a binary PPM. Throws std::runtime_error when the
+    // file can't be written.
+    void writePpm(const std::string& path) const;
+
+    // Like glfwGetProcAddress, for GL extensions.
+    static auto getProcAddress(const char* name) -> void*;
+
+private:
+    int width_ = 0;
+    int height_ = 0;
+
+    void* display_ = nullptr;
+    void* context_ = nullptr;
+    // Only used when the driver can't make a context current without one.
+    void* surface_ = nullptr;
+
+    std::uint32_t framebuffer_ = 0;
+    std::uint32_t colorBuffer_ = 0;
+};
+
+} // namespace glFractals
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ButtonState.hpp"
+
+#include <cstdint>
+
+namespace glFractals {
+
+enum class Event;
+
+// One platform callback, already mapped to an Event. Queued by the Framework
+// callbacks and handed to the listeners once per update.
+struct InputEvent {
+    enum class Kind : std::uint8_t {
+        KEY,
+        MOUSE_BUTTON,
+        CURSOR,
+        SCROLL,
+        CLOSE,
+        RESIZE
+    };
+
+    Kind kind = Kind::KEY;
+    ButtonState state = ButtonState::RELEASED;
+    // NONE for cursor, scroll, close and resize events.
+    Event event = {};
+    // Seconds since the Framework started.
+    float time = 0.0f;
+    // The cursor position, or the new size for RESIZE.
+    float x = 0.0f;
+    float y = 0.0f;
+    float scrollX = 0.0f;
+    float scrollY = 0.0f;
+};
+
+} // namespace glFractals
@@ -0,0 +1,150 @@
+#include "InputLog.hpp"
+
+#include "Bytes.hpp"
+#include "Event.hpp"
+
+#include <iterator>
+#include <stdexcept>
+
+namespace glFractals {
+
+static constexpr char MAGIC[4] = {'G', 'F', 'I', 'N'};
+static constexpr std::uint32_t VERSION = 1;
+// Follows the event kinds.
+static constexpr unsigned char UPDATE_RECORD = 0xff;
+
+// Which coordinates a kind of event uses.
+static auto hasPosition(InputEvent::Kind kind) -> bool
+{
+    return kind == InputEvent::Kind::MOUSE_BUTTON ||
+           kind == InputEvent::Kind::CURSOR ||
+           kind == InputEvent::Kind::SCROLL || kind == InputEvent::Kind::RESIZE;
+}
+
+static auto hasScroll(InputEvent::Kind kind) -> bool
+{
+    return kind == InputEvent::Kind::SCROLL;
+}
+
+InputRecorder::InputRecorder(const std::string& path,
+                             Point2D<int> resolution,
+                             float startTime)
+    : file_(path, std::ios::binary | std::ios::trunc)
+{
+    if (!file_) {
+        throw std::runtime_error("failed to open " + path);
+    }
+
+    std::vector<unsigned char> header(std::begin(MAGIC), std::end(MAGIC));
+    putU32(header, VERSION);
+    putU32(header, static_cast<std::uint32_t>(resolution.x));
+    putU32(header, static_cast<std::uint32_t>(resolution.y));
+    putFloat(header, startTime);
+    file_.write(reinterpret_cast<const char*>(header.data()), header.size());
+}
+
+void InputRecorder::write(const InputEvent& event)
+{
+    record_.clear();
+    putFloat(record_, event.time);
+    record_.push_back(static_cast<unsigned char>(event.kind));
+    record_.push_back(static_cast<unsigned char>(event.state));
+    record_.push_back(static_cast<unsigned char>(event.event));
+    if (hasPosition(event.kind)) {
+        putFloat(record_, event.x);
+        putFloat(record_, event.y);
+    }
+    if (hasScroll(event.kind)) {
+        putFloat(record_, event.scrollX);
+        putFloat(record_, event.scrollY);
+    }
+    file_.write(reinterpret_cast<const char*>(record_.data()), record_.size());
+}
+
+void InputRecorder::writeUpdate(float time)
+{
+    record_.clear();
+    putFloat(record_, time);
+    record_.push_back(UPDATE_RECORD);
+    file_.write(reinterpret_cast<const char*>(record_.data()), record_.size());
+}
+
+InputReplay::InputReplay(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    const auto data = std::vector<unsigned char>(
+        std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    auto reader = ByteReader(data, path);
+    for (const auto c : MAGIC) {
+        if (reader.byte() != static_cast<unsigned char>(c)) {
+            throw std::runtime_error(path + " is not an input log");
+        }
+    }
+    if (reader.u32() != VERSION) {
+        throw std::runtime_error(path + " has an unknown input log version");
+    }
+    resolution_.x = static_cast<int>(reader.u32());
+    resolution_.y = static_cast<int>(reader.u32());
+    startTime_ = reader.f32();
+
+    while (!reader.done()) {
+        auto record = Record();
+        auto& event = record.event;
+        event.time = reader.f32();
+        const auto kind = reader.byte();
+        if (kind == UPDATE_RECORD) {
+            record.update = true;
+            records_.push_back(record);
+            continue;
+        }
+        if (kind > static_cast<unsigned char>(InputEvent::Kind::RESIZE)) {
+            throw std::runtime_error(path + " holds an unknown event kind");
+        }
+        event.kind = static_cast<InputEvent::Kind>(kind);
+        event.state = static_cast<ButtonState>(reader.byte());
+        event.event = static_cast<Event>(reader.byte());
+        if (hasPosition(event.kind)) {
+            event.x = reader.f32();
+            event.y = reader.f32();
+        }
+        if (hasScroll(event.kind)) {
+            event.scrollX = reader.f32();
+            event.scrollY = reader.f32();
+        }
+        records_.push_back(record);
+    }
+}
+
+auto InputReplay::resolution() const -> Point2D<int> { return resolution_; }
+
+auto InputReplay::startTime() const -> float { return startTime_; }
+
+auto InputReplay::nextEvent(float time) -> const InputEvent*
+{
+    if (next_ == records_.size() || records_[next_].update ||
+        records_[next_].event.time >= time) {
+        return nullptr;
+    }
+    return &records_[next_++].event;
+}
+
+auto InputReplay::nextUpdate(float time, float& updateTime) -> bool
+{
+    if (next_ == records_.size() || !records_[next_].update ||
+        records_[next_].event.time >= time) {
+        return false;
+    }
+    updateTime = records_[next_++].event.time;
+    return true;
+}
+
+auto InputReplay::finished() const -> bool
+{
+    return next_ == records_.size();
+}
+
+} // namespace glFractals
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Common.hpp"
+#include "InputEvent.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// Input logs hold the events a session handed to its listeners and the times
+// it updated its state, so the session can be replayed exactly. The file
+// starts with the magic "GFIN", a version, the window size and the start
+// time, followed by one record per event or update: the time and kind, then
+// for events the state, event and only the coordinates the kind uses. Values
+// are stored little endian.
+class InputRecorder {
+public:
+    // Throws std::runtime_error when the file can't be written.
+    InputRecorder(const std::string& path,
+                  Point2D<int> resolution,
+                  float startTime);
+
+    void write(const InputEvent& event);
+    void writeUpdate(float time);
+
+private:
+    std::ofstream file_;
+    std::vector<unsigned char> record_;
+};
+
+class InputReplay {
+public:
+    // Reads the whole log. Throws std::runtime_error when the file can't be
+    // read or isn't an input log.
+    explicit InputReplay(const std::string& path);
+
+    // The window size and time the session started with.
+    auto resolution() const -> Point2D<int>;
+    auto startTime() const -> float;
+
+    // The next record if it is an event from before time, null otherwise.
+    // Returned events are consumed.
+    auto nextEvent(float time) -> const InputEvent*;
+    // Consumes the next record and returns true if it is an update from
+    // before time.
+    auto nextUpdate(float time, float& updateTime) -> bool;
+
+    // Whether every record was consumed.
+    auto finished() const -> bool;
+
+private:
+    struct Record {
+        bool update = false;
+        // Only the time is set for updates.
+        InputEvent event = {};
+    };
+
+    Point2D<int> resolution_ = {};
+    float startTime_ = 0.0f;
+    std::vector<Record> records_;
+    std::size_t next_ = 0;
+};
+
+} // namespace glFractals
@@ -0,0 +1,194 @@
+#include "SharedFrameRing.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace glFractals {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "atomics in shared memory have to be lock free");
+
+// Keeps every slot and buffer on its own cache lines.
+static constexpr std::size_t ALIGNMENT = 64;
+
+static auto alignUp(std::size_t size) -> std::size_t
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+static auto errorString(const std::string& what) -> std::string
+{
+    return what + ": " + std::strerror(errno);
+}
+
+SharedFrameRing::SharedFrameRing(const std::string& name, Point2D<int> maxSize)
+    : name_(name.empty() || name[0] != '/' ? "/" + name : name)
+{
+    create(maxSize);
+}
+
+SharedFrameRing::~SharedFrameRing() { release(); }
+
+void SharedFrameRing::publish(const FractalParams& params,
+                              Point2D<int> size,
+                              const unsigned char* rgba,
+                              const float* values,
+                              const Symmetry* symmetry)
+{
+    if (size.x <= 0 || size.y <= 0) {
+        return;
+    }
+    const auto maxSize = Point2D<int>{static_cast<int>(header().maxWidth),
+                                      static_cast<int>(header().maxHeight)};
+    if (size.x > maxSize.x || size.y > maxSize.y) {
+        release();
+        create({std::max(size.x, maxSize.x), std::max(size.y, maxSize.y)});
+    }
+
+    auto& ring = header();
+    const auto frame = published_ + 1;
+    auto* memory =
+        memory_ + ring.headerSize + frame % ring.slotCount * ring.slotSize;
+    auto& slot = *reinterpret_cast<SharedFrameSlot*>(memory);
+
+    // The odd sequence has to be visible before any of the new contents.
+    const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.frame = frame;
+    slot.nanoseconds = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    slot.width = static_cast<std::uint32_t>(size.x);
+    slot.height = static_cast<std::uint32_t>(size.y);
+    slot.fractalType = static_cast<std::uint32_t>(params.type);
+    slot.mode = static_cast<std::uint32_t>(params.mode);
+    slot.power = static_cast<std::uint32_t>(params.formula.power);
+    slot.fold = static_cast<std::uint32_t>(params.formula.fold);
+    slot.iterations = params.iterations;
+    slot.hasValues = values != nullptr;
+    slot.centerX = params.compCenter.x;
+    slot.centerY = params.compCenter.y;
+    slot.viewWidth = params.compResolution.x;
+    slot.viewHeight = params.compResolution.y;
+    slot.seedX = params.seed.x;
+    slot.seedY = params.seed.y;
+
+    // Flip the rows into the usual image order on the way.
+    const auto width = static_cast<std::size_t>(size.x);
+    auto* rgbaOut = memory + ring.rgbaOffset;
+    for (int y = 0; y < size.y; y++) {
+        const auto row = static_cast<std::size_t>(size.y - 1 - y);
+        std::memcpy(rgbaOut + y * width * 4, rgba + row * width * 4, width * 4);
+    }
+    auto* valuesOut = reinterpret_cast<float*>(memory + ring.valuesOffset);
+    if (values != nullptr && symmetry != nullptr) {
+        // Mirroring needs the GL row order, the rows are flipped after.
+        std::memcpy(valuesOut, values, width * size.y * sizeof(float));
+        symmetry->mirror(valuesOut);
+        for (int y = 0; y < size.y / 2; y++) {
+            auto* row = valuesOut + y * width;
+            std::swap_ranges(
+                row, row + width, valuesOut + (size.y - 1 - y) * width);
+        }
+    }
+    else if (values != nullptr) {
+        for (int y = 0; y < size.y; y++) {
+            const auto row = static_cast<std::size_t>(size.y - 1 - y);
+            std::memcpy(valuesOut + y * width,
+                        values + row * width,
+                        width * sizeof(float));
+        }
+    }
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    ring.latestFrame.store(frame, std::memory_order_release);
+    published_ = frame;
+}
+
+auto SharedFrameRing::name() const -> const std::string& { return name_; }
+
+auto SharedFrameRing::published() const -> std::uint64_t
+{
+    return published_;
+}
+
+auto SharedFrameRing::header() -> SharedFrameHeader&
+{
+    return *reinterpret_cast<SharedFrameHeader*>(memory_);
+}
+
+void SharedFrameRing::create(Point2D<int> maxSize)
+{
+    const auto pixels = static_cast<std::size_t>(std::max(1, maxSize.x)) *
+                        static_cast<std::size_t>(std::max(1, maxSize.y));
+    const auto headerSize = alignUp(sizeof(SharedFrameHeader));
+    const auto rgbaOffset = alignUp(sizeof(SharedFrameSlot));
+    const auto valuesOffset = rgbaOffset + alignUp(pixels * 4);
+    const auto slotSize = valuesOffset + alignUp(pixels * sizeof(float));
+    const auto size = headerSize + SLOT_COUNT * slotSize;
+
+    // A crashed run may have left one behind.
+    shm_unlink(name_.c_str());
+    const auto fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw std::runtime_error(
+            errorString("failed to create shared memory " + name_));
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        const auto error = errorString("failed to size shared memory " + name_);
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        throw std::runtime_error(error);
+    }
+    auto* memory =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        const auto error = errorString("failed to map shared memory " + name_);
+        shm_unlink(name_.c_str());
+        throw std::runtime_error(error);
+    }
+    memory_ = static_cast<unsigned char*>(memory);
+    size_ = size;
+
+    auto& ring = *new (memory_) SharedFrameHeader();
+    ring.headerSize = static_cast<std::uint32_t>(headerSize);
+    ring.slotCount = SLOT_COUNT;
+    ring.slotSize = slotSize;
+    ring.rgbaOffset = rgbaOffset;
+    ring.valuesOffset = valuesOffset;
+    ring.maxWidth = static_cast<std::uint32_t>(std::max(1, maxSize.x));
+    ring.maxHeight = static_cast<std::uint32_t>(std::max(1, maxSize.y));
+    for (std::uint32_t i = 0; i < SLOT_COUNT; i++) {
+        new (memory_ + headerSize + i * slotSize) SharedFrameSlot();
+    }
+    // The magic goes in last, readers that find it see the rest.
+    ring.version = SharedFrameHeader::VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    ring.magic = SharedFrameHeader::MAGIC;
+}
+
+void SharedFrameRing::release()
+{
+    if (memory_ == nullptr) {
+        return;
+    }
+    header().closed.store(1, std::memory_order_release);
+    munmap(memory_, size_);
+    shm_unlink(name_.c_str());
+    memory_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace glFractals
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Common.hpp"
+#include "FractalParams.hpp"
+#include "Symmetry.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace glFractals {
+
+// The layout of the shared memory object, in native byte order, so other
+// processes can map it and read the frames in place. The object starts with
+// a SharedFrameHeader, followed by slotCount slots of slotSize bytes from
+// offset headerSize. Every slot starts with a SharedFrameSlot, its RGBA
+// pixels are rgbaOffset bytes into it and its iteration values, one float
+// per pixel, valuesOffset bytes into it. Both have rows top down.
+//
+// Frame n goes into slot n % slotCount. Readers take latestFrame, read its
+// slot's sequence, skip it while it is odd, read the slot and then check the
+// sequence again. If it changed, the slot was overwritten while they read it.
+struct SharedFrameHeader {
+    static constexpr std::uint32_t MAGIC = 0x52464c47; // "GLFR"
+    static constexpr std::uint32_t VERSION = 1;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t headerSize;
+    std::uint32_t slotCount;
+    std::uint64_t slotSize;
+    std::uint64_t rgbaOffset;
+    std::uint64_t valuesOffset;
+    // The largest frame a slot holds.
+    std::uint32_t maxWidth;
+    std::uint32_t maxHeight;
+    // The newest complete frame, 0 before the first.
+    std::atomic<std::uint64_t> latestFrame;
+    // Set once nothing is published here anymore, because the renderer
+    // exited or moved to a larger object under the same name.
+    std::atomic<std::uint32_t> closed;
+};
+
+struct SharedFrameSlot {
+    // Odd while the slot is written.
+    std::atomic<std::uint64_t> sequence;
+    std::uint64_t frame;
+    // When the frame was published, on the steady clock.
+    std::uint64_t nanoseconds;
+    std::uint32_t width;
+    std::uint32_t height;
+    // FractalType, RenderMode and the Formula.
+    std::uint32_t fractalType;
+    std::uint32_t mode;
+    std::uint32_t power;
+    std::uint32_t fold;
+    std::int32_t iterations;
+    // 0 when the frame has no values, like the Buddhabrot.
+    std::uint32_t hasValues;
+    double centerX;
+    double centerY;
+    // The size of the view on the complex plane.
+    double viewWidth;
+    double viewHeight;
+    double seedX;
+    double seedY;
+};
+
+// Publishes frames into a POSIX shared memory ring for local consumers, see
+// SharedFrameHeader. The object is created on construction, replacing any
+// left over one, and removed on destruction.
+class SharedFrameRing {
+public:
+    static constexpr std::uint32_t SLOT_COUNT = 4;
+
+    // Name is a shared memory object name, with or without the leading
+    // slash. Slots hold frames up to maxSize.
+    SharedFrameRing(const std::string& name, Point2D<int> maxSize);
+    ~SharedFrameRing();
+
+    SharedFrameRing(const SharedFrameRing&) = delete;
+    SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+
+    // Copies a frame into the next slot. Rows are bottom up as GL reads
+    // them, values may be null. Symmetry, unless null, says which values are
+    // mirror copies still to be filled in. Frames larger than the slots move
+    // the ring to a new object large enough.
+    void publish(const FractalParams& params,
+                 Point2D<int> size,
+                 const unsigned char* rgba,
+                 const float* values,
+                 const Symmetry* symmetry = nullptr);
+
+    auto name() const -> const std::string&;
+    auto published() const -> std::uint64_t;
+
+private:
+    std::string name_;
+    unsigned char* memory_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint64_t published_ = 0;
+
+    auto header() -> SharedFrameHeader&;
+    void create(Point2D<int> maxSize);
+    void release();
+};
+
+} // namespace glFractals
@@ -0,0 +1,164 @@
+#include "DebugOutput.hpp"
+
+#include "gl_utils.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+// From GL_KHR_debug, which glad doesn't load for GL 3.3.
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+#ifndef GL_DEBUG_SEVERITY_HIGH
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#endif
+#ifndef GL_DEBUG_SEVERITY_MEDIUM
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#endif
+#ifndef GL_DEBUG_SEVERITY_LOW
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#endif
+#ifndef GL_DEBUG_SEVERITY_NOTIFICATION
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#endif
+#ifndef GL_DEBUG_TYPE_ERROR
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#endif
+#ifndef GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#endif
+#ifndef GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR 0x824E
+#endif
+#ifndef GL_DEBUG_TYPE_PORTABILITY
+#define GL_DEBUG_TYPE_PORTABILITY 0x824F
+#endif
+#ifndef GL_DEBUG_TYPE_PERFORMANCE
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#endif
+
+namespace glFractals {
+
+using DebugMessageCallbackProc = void(APIENTRYP)(GLDEBUGPROC callback,
+                                                 const void* userParam);
+using DebugMessageControlProc = void(APIENTRYP)(GLenum source,
+                                                GLenum type,
+                                                GLenum severity,
+                                                GLsizei count,
+                                                const GLuint* ids,
+                                                GLboolean enabled);
+
+// Most severe first, DebugSeverity::HIGH enables the first entry.
+static constexpr GLenum SEVERITIES[] = {GL_DEBUG_SEVERITY_HIGH,
+                                        GL_DEBUG_SEVERITY_MEDIUM,
+                                        GL_DEBUG_SEVERITY_LOW,
+                                        GL_DEBUG_SEVERITY_NOTIFICATION};
+
+static auto severityName(GLenum severity) -> const char*
+{
+    switch (severity) {
+        case GL_DEBUG_SEVERITY_HIGH:
+            return "high";
+        case GL_DEBUG_SEVERITY_MEDIUM:
+            return "medium";
+        case GL_DEBUG_SEVERITY_LOW:
+            return "low";
+        default:
+            return "notification";
+    }
+}
+
+static auto typeName(GLenum type) -> const char*
+{
+    switch (type) {
+        case GL_DEBUG_TYPE_ERROR:
+            return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+            return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+            return "undefined behavior";
+        case GL_DEBUG_TYPE_PORTABILITY:
+            return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE:
+            return "performance";
+        default:
+            return "other";
+    }
+}
+
+// May be called from any thread, so only touches its arguments.
+static void APIENTRY debugCallback(GLenum /*source*/,
+                                   GLenum type,
+                                   GLuint id,
+                                   GLenum severity,
+                                   GLsizei /*length*/,
+                                   const GLchar* message,
+                                   const void* /*userParam*/)
+{
+    std::fprintf(stderr,
+                 "GL %s (%s, id %u): %s\n",
+                 typeName(type),
+                 severityName(severity),
+                 id,
+                 message);
+}
+
+auto debugSeverityByName(const std::string& name) -> DebugSeverity
+{
+    if (name == "off") {
+        return DebugSeverity::OFF;
+    }
+    if (name == "high") {
+        return DebugSeverity::HIGH;
+    }
+    if (name == "medium") {
+        return DebugSeverity::MEDIUM;
+    }
+    if (name == "low") {
+        return DebugSeverity::LOW;
+    }
+    if (name == "all") {
+        return DebugSeverity::NOTIFICATION;
+    }
+    throw std::runtime_error("unknown debug severity " + name +
+                             ", expected off, high, medium, low or all");
+}
+
+auto enableDebugOutput(GLADloadproc loadProc, DebugSeverity severity) -> bool
+{
+    if (severity == DebugSeverity::OFF) {
+        return true;
+    }
+
+    GLint major = 0;
+    GLint minor = 0;
+    GL(glGetIntegerv(GL_MAJOR_VERSION, &major));
+    GL(glGetIntegerv(GL_MINOR_VERSION, &minor));
+    if (!(major > 4 || (major == 4 && minor >= 3)) &&
+        !hasGLExtension("GL_KHR_debug")) {
+        return false;
+    }
+
+    const auto messageCallback = reinterpret_cast<DebugMessageCallbackProc>(
+        loadProc("glDebugMessageCallback"));
+    const auto messageControl = reinterpret_cast<DebugMessageControlProc>(
+        loadProc("glDebugMessageControl"));
+    if (messageCallback == nullptr || messageControl == nullptr) {
+        return false;
+    }
+
+    // Only the requested severities reach the callback, the driver drops the
+    // rest before formatting them.
+    GL(messageControl(
+        GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE));
+    for (int i = 0; i < static_cast<int>(severity); i++) {
+        GL(messageControl(
+            GL_DONT_CARE, GL_DONT_CARE, SEVERITIES[i], 0, nullptr, GL_TRUE));
+    }
+    GL(messageCallback(debugCallback, nullptr));
+    // Not GL_DEBUG_OUTPUT_SYNCHRONOUS, the driver reports when it gets to it.
+    GL(glEnable(GL_DEBUG_OUTPUT));
+    return true;
+}
+
+} // namespace glFractals
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <string>
+
+namespace glFractals {
+
+// The least severe driver messages reported, each level includes the ones
+// before it.
+enum class DebugSeverity { OFF, HIGH, MEDIUM, LOW, NOTIFICATION };
+
+// Returns the severity for "off", "high", "medium", "low" or "all". Throws on
+// anything else.
+auto debugSeverityByName(const std::string& name) -> DebugSeverity;
+
+// Prints the driver's KHR_debug messages of at least severity to stderr.
+// Messages arrive through a callback, possibly from a driver thread, so
+// unlike GL() nothing waits on the driver. GL 3.3 doesn't have debug output,
+// so its entry points are loaded with loadProc. Returns false when the driver
+// has neither GL 4.3 nor GL_KHR_debug. Messages are only guaranteed in a
+// debug context, see Framework.
+auto enableDebugOutput(GLADloadproc loadProc, DebugSeverity severity) -> bool;
+
+} // namespace glFractals
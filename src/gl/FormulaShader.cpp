@@ -0,0 +1,101 @@
+#include "FormulaShader.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace glFractals {
+
+// Emits the statements computing w^n by repeated squaring and returns the
+// variable holding it.
+static auto emitPower(std::ostream& out, int n) -> std::string
+{
+    if (n == 1) {
+        return "w";
+    }
+
+    const auto half = emitPower(out, n / 2);
+    const auto square = "w" + std::to_string(n / 2 * 2);
+    out << "    vec2 " << square << " = complexMul(" << half << ", " << half
+        << ");\n";
+    if (n % 2 == 0) {
+        return square;
+    }
+
+    const auto result = "w" + std::to_string(n);
+    out << "    vec2 " << result << " = complexMul(" << square << ", w);\n";
+    return result;
+}
+
+auto formulaShaderSource(const Formula& formula) -> std::string
+{
+    if (formula.power < 2 || formula.power > MAX_FORMULA_POWER) {
+        throw std::runtime_error("formula power out of range");
+    }
+
+    std::stringstream ss;
+    ss << "#version 330\n"
+       << "\n"
+       << "// Generated by formulaShaderSource for " << formulaName(formula)
+       << ".\n"
+       << "\n"
+       << "vec2 complexMul(vec2 a, vec2 b)\n"
+       << "{\n"
+       << "    return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);\n"
+       << "}\n"
+       << "\n";
+
+    ss << "vec2 formulaFold(vec2 z) { ";
+    switch (formula.fold) {
+        case Fold::ABS:
+            ss << "return abs(z); }\n";
+            break;
+        case Fold::CONJUGATE:
+            ss << "return vec2(z.x, -z.y); }\n";
+            break;
+        default:
+            ss << "return z; }\n";
+            break;
+    }
+
+    // The folds are reflections, so their derivative reflects dz the same
+    // way.
+    ss << "\n"
+       << "vec2 formulaFoldDerivative(vec2 z, vec2 dz) { ";
+    switch (formula.fold) {
+        case Fold::ABS:
+            ss << "return vec2(z.x < 0.0 ? -dz.x : dz.x, "
+                  "z.y < 0.0 ? -dz.y : dz.y); }\n";
+            break;
+        case Fold::CONJUGATE:
+            ss << "return vec2(dz.x, -dz.y); }\n";
+            break;
+        default:
+            ss << "return dz; }\n";
+            break;
+    }
+
+    ss << "\n"
+       << "// Returns fold(z)^" << formula.power << " + c.\n"
+       << "vec2 formulaStep(vec2 z, vec2 c)\n"
+       << "{\n"
+       << "    vec2 w = formulaFold(z);\n";
+    const auto power = emitPower(ss, formula.power);
+    ss << "    return " << power << " + c;\n"
+       << "}\n";
+
+    ss << "\n"
+       << "// Returns the derivative of formulaStep given the derivative dz of "
+          "z and dc\n"
+       << "// of c.\n"
+       << "vec2 formulaDerivative(vec2 z, vec2 dz, vec2 dc)\n"
+       << "{\n"
+       << "    vec2 w = formulaFold(z);\n";
+    const auto lowerPower = emitPower(ss, formula.power - 1);
+    ss << "    return " << formula.power << ".0 * complexMul(" << lowerPower
+       << ", formulaFoldDerivative(z, dz)) + dc;\n"
+       << "}\n";
+
+    return ss.str();
+}
+
+} // namespace glFractals
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Formula.hpp"
+
+#include <string>
+
+namespace glFractals {
+
+// Generates the fragment shader defining formulaStep and formulaDerivative
+// for formula, which Mandelbrot.fs and Julia.fs iterate. The power is
+// unrolled into complex multiplies the same way ComplexPow does on the CPU.
+auto formulaShaderSource(const Formula& formula) -> std::string;
+
+} // namespace glFractals
@@ -1,11 +1,16 @@
 #include "FractalRenderer.hpp"
 
 #include "Shader.hpp"
-#include "StateController.hpp"
+#include "Symmetry.hpp"
 #include "gl_utils.h"
 
 #include "glad/glad.h"
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
 namespace glFractals {
 
 // We just need a fullscreen quad to get fragments everywhere on the screen.
@@ -15,9 +20,71 @@ static constexpr float QUAD_VERTICES[] = {
 static constexpr int NUM_QUAD_VERTICES =
     sizeof(QUAD_VERTICES) / sizeof(QUAD_VERTICES[0]);
 
-FractalRenderer::FractalRenderer(int newWidth, int newHeight)
-    : width_(newWidth), height_(newHeight)
+// The FrameParams uniform block in std140 layout, where scalars and bools
+// take four bytes each. Keep in sync with the shaders.
+struct FrameUniforms {
+    std::int32_t iterations = 0;
+    std::int32_t distanceEstimation = 0;
+    float viewWidth = 0.0f;
+    float viewHeight = 0.0f;
+    float compWidth = 0.0f;
+    float compHeight = 0.0f;
+    float compCenterX = 0.0f;
+    float compCenterY = 0.0f;
+    float seedX = 0.0f;
+    float seedY = 0.0f;
+    std::int32_t symmetry = 0;
+    std::int32_t mirrorOffsetX = 0;
+    std::int32_t mirrorOffsetY = 0;
+};
+static_assert(sizeof(FrameUniforms) == 13 * 4, "std140 packs the scalars");
+
+static constexpr GLuint FRAME_PARAMS_BINDING = 0;
+
+// How long the params have to stay the same before the view counts as
+// stopped and gets a full resolution frame. A drag sends cursor moves less
+// often than frames are drawn, this bridges the gaps.
+static constexpr auto SETTLE_TIME = std::chrono::milliseconds(200);
+
+// Points the FrameParams block at the shared buffer and the values sampler, if
+// the program has one, at texture unit 0.
+static void prepareProgram(Shader& shader)
+{
+    shader.bindUniformBlock("FrameParams", FRAME_PARAMS_BINDING);
+    shader.use();
+    shader.setUniform("values", 0);
+}
+
+FractalShaders::FractalShaders(Shader valuesShader,
+                               Shader refineShader,
+                               Formula formulaUsed)
+    : values(std::move(valuesShader)), refine(std::move(refineShader)),
+      formula(formulaUsed), subsamples(refine.uniform<int>("subsamples")),
+      threshold(refine.uniform<float>("threshold"))
+{
+    prepareProgram(values);
+    prepareProgram(refine);
+}
+
+FractalRenderer::FractalRenderer(Shader& resolveShader,
+                                 int newWidth,
+                                 int newHeight)
+    : resolveShader_(resolveShader),
+      directColors_(resolveShader.uniform<bool>("directColors")),
+      valueScale_(resolveShader.uniform<Point2D<float>>("valueScale")),
+      width_(newWidth), height_(newHeight), valueSize_(newWidth, newHeight)
 {
+    prepareProgram(resolveShader_);
+    resolveShader_.setUniform("colors", 1);
+
+    GL(glGenBuffers(1, &frameUbo_));
+    GL(glBindBuffer(GL_UNIFORM_BUFFER, frameUbo_));
+    GL(glBufferData(GL_UNIFORM_BUFFER,
+                    sizeof(FrameUniforms),
+                    nullptr,
+                    GL_DYNAMIC_DRAW));
+    GL(glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_PARAMS_BINDING, frameUbo_));
+
     GL(glGenVertexArrays(1, &vao_));
     GL(glGenBuffers(1, &vbo_));
 
@@ -39,35 +106,419 @@ FractalRenderer::FractalRenderer(int newWidth, int newHeight)
     GL(glVertexAttribPointer(
         0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0));
     GL(glEnableVertexAttribArray(0));
+
+    GL(glGenQueries(NUM_QUERIES, queries_));
+    GL(glGenQueries(NUM_QUERIES, timeQueries_));
+
+    allocateValueTarget();
 }
 
-FractalRenderer::FractalRenderer(Point2D<int> newResolution)
-    : FractalRenderer(newResolution.x, newResolution.y)
+FractalRenderer::FractalRenderer(Shader& resolveShader,
+                                 Point2D<int> newResolution)
+    : FractalRenderer(resolveShader, newResolution.x, newResolution.y)
 {
 }
 
 FractalRenderer::~FractalRenderer()
 {
+    releaseValueTarget();
+    GL(glDeleteQueries(NUM_QUERIES, queries_));
+    GL(glDeleteQueries(NUM_QUERIES, timeQueries_));
+    GL(glDeleteBuffers(1, &frameUbo_));
     GL(glDeleteBuffers(1, &vbo_));
     GL(glDeleteVertexArrays(1, &vao_));
 }
 
-void FractalRenderer::render(Shader& shader, const StateController& controller)
+void FractalRenderer::render(FractalShaders& shaders,
+                             const FractalParams& frameParams)
 {
-    shader.use();
+    // Blending would mix in the undefined alpha of the value target.
+    GL(glDisable(GL_BLEND));
+    GL(glBindVertexArray(vao_));
+
+    auto params = frameParams;
+    params.formula = shaders.formula;
+
+    collectQueries();
+
+    const auto now = std::chrono::steady_clock::now();
+    if (params != lastParams_) {
+        lastParams_ = params;
+        lastChange_ = now;
+        valuesComplete_ = false;
+    }
+    frameFinished_ = valuesComplete_ && antiAliasingChanged_;
+    if (!valuesComplete_) {
+        const auto moving = now - lastChange_ < SETTLE_TIME;
+        const auto scale = moving ? dynamicResolution_.scale() : 1.0f;
+        renderValues(shaders, params, scale);
+        valuesComplete_ = (scale == 1.0f);
+        frameFinished_ = valuesComplete_;
+    }
+    antiAliasingChanged_ = false;
+    drewColors_ = false;
+
+    resolve();
+
+    // Refining samples the fractal at window pixels, which only line up with
+    // the values at full resolution.
+    if (!antiAliasing_.enabled || valueSize_ != Point2D<int>(width_, height_)) {
+        return;
+    }
+
+    // Overwrite the high variance pixels with their supersampled color. The
+    // other pixels are discarded by the shader, so the query counts the
+    // samples of exactly the refined pixels. A multisampled target passes
+    // all of a pixel's samples, hence the sample count to divide by.
+    shaders.refine.use();
+    shaders.subsamples.set(antiAliasing_.subsamples);
+    shaders.threshold.set(antiAliasing_.threshold);
+
+    auto samples = GLint(0);
+    GL(glGetIntegerv(GL_SAMPLES, &samples));
+    querySamples_[nextQuery_] = std::max(1, samples);
+    GL(glBeginQuery(GL_SAMPLES_PASSED, queries_[nextQuery_]));
+    GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, NUM_QUAD_VERTICES));
+    GL(glEndQuery(GL_SAMPLES_PASSED));
+    queryPending_[nextQuery_] = true;
+    querySubsamples_[nextQuery_] = antiAliasing_.subsamples;
+    nextQuery_ = (nextQuery_ + 1) % NUM_QUERIES;
+}
+
+void FractalRenderer::renderValues(FractalShaders& shaders,
+                                   const FractalParams& params,
+                                   float scale)
+{
+    valueSize_ = {std::max(1, static_cast<int>(std::lround(width_ * scale))),
+                  std::max(1, static_cast<int>(std::lround(height_ * scale)))};
+    auto valueParams = params;
+    valueParams.viewResolution = valueSize_;
+
+    const auto symmetry = Symmetry(valueParams, symmetry_);
+    mirroredPixels_ = symmetry.copiedPixels();
+
+    // Every pass of the frame reads the same parameters.
+    uploadFrameParams(valueParams, &symmetry);
 
+    // One sample per pixel into the value target, skipping mirror copies.
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, valueFbo_));
+    GL(glViewport(0, 0, valueSize_.x, valueSize_.y));
+    shaders.values.use();
+    GL(glBeginQuery(GL_TIME_ELAPSED, timeQueries_[nextTimeQuery_]));
+    GL(glEnable(GL_SCISSOR_TEST));
+    for (const auto& rect : symmetry.uniqueRects()) {
+        GL(glScissor(
+            rect.x0, rect.y0, rect.x1 - rect.x0 + 1, rect.y1 - rect.y0 + 1));
+        GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, NUM_QUAD_VERTICES));
+    }
+    GL(glDisable(GL_SCISSOR_TEST));
+    GL(glEndQuery(GL_TIME_ELAPSED));
+    timePending_[nextTimeQuery_] = true;
+    timeScales_[nextTimeQuery_] = scale;
+    nextTimeQuery_ = (nextTimeQuery_ + 1) % NUM_QUERIES;
+}
+
+void FractalRenderer::render(const std::vector<float>& values)
+{
+    if (values.size() != static_cast<std::size_t>(width_) * height_) {
+        return;
+    }
+
+    GL(glDisable(GL_BLEND));
     GL(glViewport(0, 0, width_, height_));
+    GL(glBindVertexArray(vao_));
+
+    GL(glActiveTexture(GL_TEXTURE0));
+    GL(glBindTexture(GL_TEXTURE_2D, valueTex_));
+    GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    GL(glTexSubImage2D(GL_TEXTURE_2D,
+                       0,
+                       0,
+                       0,
+                       width_,
+                       height_,
+                       GL_RED,
+                       GL_FLOAT,
+                       values.data()));
+    // Other engines fill in their mirror copies themselves.
+    mirroredPixels_ = 0;
+    valueSize_ = {width_, height_};
+    valuesComplete_ = false;
+    frameFinished_ = false;
+    drewColors_ = false;
+    auto params = FractalParams();
+    params.viewResolution = valueSize_;
+    uploadFrameParams(params, nullptr);
+    resolve();
+}
 
-    controller.programShader(shader);
+void FractalRenderer::renderColors(const std::vector<float>& colors)
+{
+    if (colors.size() != static_cast<std::size_t>(width_) * height_ * 3) {
+        return;
+    }
 
+    GL(glDisable(GL_BLEND));
+    GL(glViewport(0, 0, width_, height_));
     GL(glBindVertexArray(vao_));
+
+    GL(glActiveTexture(GL_TEXTURE1));
+    if (colorTex_ == 0) {
+        GL(glGenTextures(1, &colorTex_));
+        GL(glBindTexture(GL_TEXTURE_2D, colorTex_));
+        GL(glTexImage2D(GL_TEXTURE_2D,
+                        0,
+                        GL_RGB32F,
+                        std::max(1, width_),
+                        std::max(1, height_),
+                        0,
+                        GL_RGB,
+                        GL_FLOAT,
+                        nullptr));
+        GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    }
+    GL(glBindTexture(GL_TEXTURE_2D, colorTex_));
+    GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    GL(glTexSubImage2D(GL_TEXTURE_2D,
+                       0,
+                       0,
+                       0,
+                       width_,
+                       height_,
+                       GL_RGB,
+                       GL_FLOAT,
+                       colors.data()));
+    GL(glActiveTexture(GL_TEXTURE0));
+
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, target_));
+    resolveShader_.use();
+    directColors_.set(true);
+    GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, NUM_QUAD_VERTICES));
+    directColors_.set(false);
+    mirroredPixels_ = 0;
+    valuesComplete_ = false;
+    frameFinished_ = false;
+    drewColors_ = true;
+}
+
+void FractalRenderer::uploadFrameParams(const FractalParams& params,
+                                        const Symmetry* symmetry)
+{
+    ScopeTimer timer(profiler_, uploadSection_);
+
+    auto uniforms = FrameUniforms();
+    uniforms.iterations = params.iterations;
+    uniforms.distanceEstimation =
+        params.mode == RenderMode::DISTANCE_ESTIMATE;
+    uniforms.viewWidth = static_cast<float>(params.viewResolution.x);
+    uniforms.viewHeight = static_cast<float>(params.viewResolution.y);
+    uniforms.compWidth = static_cast<float>(params.compResolution.x);
+    uniforms.compHeight = static_cast<float>(params.compResolution.y);
+    uniforms.compCenterX = static_cast<float>(params.compCenter.x);
+    uniforms.compCenterY = static_cast<float>(params.compCenter.y);
+    uniforms.seedX = static_cast<float>(params.seed.x);
+    uniforms.seedY = static_cast<float>(params.seed.y);
+
+    // Tell the shaders where the copies are and move the center onto the
+    // grid they line up with.
+    if (symmetry != nullptr && symmetry->type() != Symmetry::Type::NONE) {
+        uniforms.symmetry = static_cast<std::int32_t>(symmetry->type());
+        uniforms.mirrorOffsetX = symmetry->offset().x;
+        uniforms.mirrorOffsetY = symmetry->offset().y;
+        uniforms.compCenterX = static_cast<float>(symmetry->compCenter().x);
+        uniforms.compCenterY = static_cast<float>(symmetry->compCenter().y);
+    }
+
+    GL(glBindBuffer(GL_UNIFORM_BUFFER, frameUbo_));
+    GL(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(uniforms), &uniforms));
+}
+
+void FractalRenderer::resolve()
+{
+    // Color every pixel from its single sample.
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, target_));
+    GL(glViewport(0, 0, width_, height_));
+    GL(glActiveTexture(GL_TEXTURE0));
+    GL(glBindTexture(GL_TEXTURE_2D, valueTex_));
+    resolveShader_.use();
+    valueScale_.set({static_cast<float>(valueSize_.x) / std::max(1, width_),
+                     static_cast<float>(valueSize_.y) / std::max(1, height_)});
     GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, NUM_QUAD_VERTICES));
 }
 
+void FractalRenderer::collectQueries()
+{
+    // Oldest query first, a later query can't finish before an earlier one.
+    for (int i = 0; i < NUM_QUERIES; i++) {
+        const auto query = (nextQuery_ + i) % NUM_QUERIES;
+        if (!queryPending_[query]) {
+            continue;
+        }
+
+        GLuint available = 0;
+        GL(glGetQueryObjectuiv(
+            queries_[query], GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available) {
+            break;
+        }
+
+        GLuint samples = 0;
+        GL(glGetQueryObjectuiv(queries_[query], GL_QUERY_RESULT, &samples));
+        refinedPixels_ = samples / querySamples_[query];
+        refinedSubsamples_ = refinedPixels_ * querySubsamples_[query];
+        queryPending_[query] = false;
+    }
+
+    for (int i = 0; i < NUM_QUERIES; i++) {
+        const auto query = (nextTimeQuery_ + i) % NUM_QUERIES;
+        if (!timePending_[query]) {
+            continue;
+        }
+
+        GLuint available = 0;
+        GL(glGetQueryObjectuiv(
+            timeQueries_[query], GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available) {
+            break;
+        }
+
+        GLuint64 nanoseconds = 0;
+        GL(glGetQueryObjectui64v(
+            timeQueries_[query], GL_QUERY_RESULT, &nanoseconds));
+        valueSeconds_ = nanoseconds * 1e-9f;
+        dynamicResolution_.addFrame(valueSeconds_, timeScales_[query]);
+        timePending_[query] = false;
+    }
+}
+
+void FractalRenderer::setAntiAliasing(const AntiAliasing& antiAliasing)
+{
+    const auto previous = antiAliasing_;
+    antiAliasing_ = antiAliasing;
+    antiAliasing_.subsamples = std::max(0, antiAliasing_.subsamples);
+    antiAliasingChanged_ =
+        antiAliasingChanged_ || antiAliasing_.enabled != previous.enabled ||
+        antiAliasing_.subsamples != previous.subsamples ||
+        antiAliasing_.threshold != previous.threshold;
+}
+
+auto FractalRenderer::antiAliasing() const -> const AntiAliasing&
+{
+    return antiAliasing_;
+}
+
+void FractalRenderer::setSymmetry(bool enabled)
+{
+    symmetry_ = enabled;
+    valuesComplete_ = false;
+}
+
+void FractalRenderer::setProfiler(Profiler* profiler, int uploadSection)
+{
+    profiler_ = profiler;
+    uploadSection_ = uploadSection;
+}
+
+void FractalRenderer::setTarget(std::uint32_t framebuffer)
+{
+    target_ = framebuffer;
+}
+
+void FractalRenderer::setFrameBudget(float seconds)
+{
+    dynamicResolution_.setBudget(seconds);
+}
+
+auto FractalRenderer::frameFinished() const -> bool { return frameFinished_; }
+
+void FractalRenderer::readFrame(FrameReadback& readback,
+                                const FractalParams& params)
+{
+    auto frameParams = params;
+    frameParams.viewResolution = {width_, height_};
+    readback.read(target_,
+                  drewColors_ ? 0 : valueFbo_,
+                  frameParams.viewResolution,
+                  frameParams,
+                  mirroredPixels_ > 0);
+}
+
+void FractalRenderer::stateLines(HudText& hud) const
+{
+    if (antiAliasing_.enabled) {
+        hud.addLine("aa: %llu px refined, %llu subsamples",
+                    static_cast<unsigned long long>(refinedPixels_),
+                    static_cast<unsigned long long>(refinedSubsamples_));
+    }
+    else {
+        hud.addLine("aa: off");
+    }
+
+    if (dynamicResolution_.budget() > 0.0f) {
+        hud.addLine("values: %dx%d, %.1f ms",
+                    valueSize_.x,
+                    valueSize_.y,
+                    valueSeconds_ * 1e3f);
+    }
+
+    const auto pixels = static_cast<long long>(valueSize_.x) * valueSize_.y;
+    if (mirroredPixels_ > 0 && pixels > 0) {
+        hud.addLine("mirrored: %lld%% of pixels",
+                    mirroredPixels_ * 100 / pixels);
+    }
+}
+
+void FractalRenderer::allocateValueTarget()
+{
+    // A minimized window reports a zero size, which no framebuffer accepts.
+    const auto width = std::max(1, width_);
+    const auto height = std::max(1, height_);
+
+    GL(glGenTextures(1, &valueTex_));
+    GL(glBindTexture(GL_TEXTURE_2D, valueTex_));
+    GL(glTexImage2D(GL_TEXTURE_2D,
+                    0,
+                    GL_R32F,
+                    width,
+                    height,
+                    0,
+                    GL_RED,
+                    GL_FLOAT,
+                    nullptr));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+
+    GL(glGenFramebuffers(1, &valueFbo_));
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, valueFbo_));
+    GL(glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, valueTex_, 0));
+    GL(auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("fractal value framebuffer incomplete");
+    }
+}
+
+void FractalRenderer::releaseValueTarget()
+{
+    GL(glDeleteFramebuffers(1, &valueFbo_));
+    GL(glDeleteTextures(1, &valueTex_));
+    GL(glDeleteTextures(1, &colorTex_));
+    valueFbo_ = 0;
+    valueTex_ = 0;
+    colorTex_ = 0;
+}
+
 void FractalRenderer::changeResolution(int newWidth, int newHeight)
 {
     width_ = newWidth;
     height_ = newHeight;
+    valueSize_ = {newWidth, newHeight};
+    valuesComplete_ = false;
+
+    releaseValueTarget();
+    allocateValueTarget();
 }
 
 void FractalRenderer::changeResolution(const Point2D<int> newResolution)
@@ -80,4 +531,4 @@ void FractalRenderer::notifyResolution(int newWidth, int newHeight)
     changeResolution(newWidth, newHeight);
 }
 
-} // namespace glFractals
\ No newline at end of file
+} // namespace glFractals
@@ -1,21 +1,90 @@
 #pragma once
 
 #include "Common.hpp"
+#include "DynamicResolution.hpp"
+#include "Formula.hpp"
+#include "FractalParams.hpp"
+#include "FrameReadback.hpp"
+#include "HudText.hpp"
+#include "Profiler.hpp"
 #include "ResolutionChangeListener.hpp"
+#include "Shader.hpp"
 
+#include <chrono>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 namespace glFractals {
-class Shader;
-class StateController;
+class Symmetry;
+
+// The programs drawing one fractal type.
+struct FractalShaders {
+    // Resolves the uniforms and binds the FrameParams blocks.
+    FractalShaders(Shader values, Shader refine, Formula formula);
+
+    // Writes the iteration value of every pixel (Iterations.fs).
+    Shader values;
+    // Adds jittered subsamples to high variance pixels (Refine.fs).
+    Shader refine;
+    // The formula both programs were generated for.
+    Formula formula;
+
+    Uniform<int> subsamples;
+    Uniform<float> threshold;
+};
+
+// Adaptive supersampling. Every pixel gets one sample, then only the pixels
+// whose neighbours differ by more than threshold iterations get subsamples.
+struct AntiAliasing {
+    bool enabled = false;
+    int subsamples = 8;
+    float threshold = 3.0f;
+};
+
 class FractalRenderer : public ResolutionChangeListener {
 public:
-    FractalRenderer(int newWidth, int newHeight);
-    FractalRenderer(Point2D<int> initial_resolution);
+    FractalRenderer(Shader& resolveShader, int newWidth, int newHeight);
+    FractalRenderer(Shader& resolveShader, Point2D<int> initial_resolution);
 
     virtual ~FractalRenderer();
 
-    void render(Shader& shader, const StateController& controller);
+    void render(FractalShaders& shaders, const FractalParams& params);
+    // Colors values rendered by another engine, one per pixel with rows
+    // bottom up. Anti-aliasing only applies to the shader path.
+    void render(const std::vector<float>& values);
+    // Shows colors rendered by another engine, three unit interval values
+    // per pixel with rows bottom up.
+    void renderColors(const std::vector<float>& colors);
+
+    void setAntiAliasing(const AntiAliasing& antiAliasing);
+    auto antiAliasing() const -> const AntiAliasing&;
+
+    // Only compute the unique part of frames covering a symmetric region.
+    void setSymmetry(bool enabled);
+
+    // Adds the CPU time of the uniform uploads to a profiler section.
+    void setProfiler(Profiler* profiler, int uploadSection);
+
+    // Frames are drawn into framebuffer, 0 is the window.
+    void setTarget(std::uint32_t framebuffer);
+
+    // While the view moves, frames are computed at a lower resolution and
+    // stretched over the window so the GPU spends about budget seconds on
+    // them. Once it stops, one full resolution frame is computed and kept.
+    // A budget of 0 computes every frame at full resolution.
+    void setFrameBudget(float seconds);
+
+    // Whether the last shader frame was the first full resolution one of its
+    // params or anti-aliasing, so one worth keeping.
+    auto frameFinished() const -> bool;
+
+    // Queues reading the colors of the target back, with the values unless
+    // the last frame was drawn from colors.
+    void readFrame(FrameReadback& readback, const FractalParams& params);
+
+    // Adds the statistics of the last finished frame to the HUD.
+    void stateLines(HudText& hud) const;
 
     // Changes the resolution of the rendering.
     void changeResolution(int newWidth, int newHeight);
@@ -25,10 +94,78 @@ public:
     void notifyResolution(int newWidth, int newHeight) override;
 
 private:
+    Shader& resolveShader_;
+    Uniform<bool> directColors_;
+    Uniform<Point2D<float>> valueScale_;
+
     int width_ = 0;
     int height_ = 0;
+    std::uint32_t target_ = 0;
+
+    Profiler* profiler_ = nullptr;
+    int uploadSection_ = 0;
 
     std::uint32_t vao_ = 0;
     std::uint32_t vbo_ = 0;
+    // Backs the FrameParams block of every program.
+    std::uint32_t frameUbo_ = 0;
+
+    // Offscreen target holding the single sample iteration values.
+    std::uint32_t valueFbo_ = 0;
+    std::uint32_t valueTex_ = 0;
+    // Only allocated once colors are rendered.
+    std::uint32_t colorTex_ = 0;
+
+    AntiAliasing antiAliasing_ = {};
+
+    DynamicResolution dynamicResolution_;
+    // The values of the last frame fill this bottom left part of the value
+    // target.
+    Point2D<int> valueSize_ = {};
+    // The shader frame drawn last and when its params last changed.
+    FractalParams lastParams_ = {};
+    std::chrono::steady_clock::time_point lastChange_ = {};
+    // Set while the value target holds lastParams_ at full resolution, so
+    // frames only need to resolve it again.
+    bool valuesComplete_ = false;
+    bool frameFinished_ = false;
+    bool antiAliasingChanged_ = false;
+    // Set while the target holds colors from renderColors, without values.
+    bool drewColors_ = false;
+
+    bool symmetry_ = true;
+    long long mirroredPixels_ = 0;
+
+    // Samples passed queries counting the refined pixels. Results are read a
+    // few frames late so we never wait on the GPU.
+    static constexpr int NUM_QUERIES = 3;
+    std::uint32_t queries_[NUM_QUERIES] = {};
+    bool queryPending_[NUM_QUERIES] = {};
+    int querySubsamples_[NUM_QUERIES] = {};
+    // The samples per pixel of the target each query counted in.
+    int querySamples_[NUM_QUERIES] = {};
+    int nextQuery_ = 0;
+    std::uint64_t refinedPixels_ = 0;
+    std::uint64_t refinedSubsamples_ = 0;
+
+    // Time elapsed queries measuring the value passes, read the same way.
+    std::uint32_t timeQueries_[NUM_QUERIES] = {};
+    bool timePending_[NUM_QUERIES] = {};
+    float timeScales_[NUM_QUERIES] = {};
+    int nextTimeQuery_ = 0;
+    float valueSeconds_ = 0.0f;
+
+    void allocateValueTarget();
+    void releaseValueTarget();
+    // Computes the values at scale times the window resolution.
+    void renderValues(FractalShaders& shaders,
+                      const FractalParams& params,
+                      float scale);
+    // Writes the FrameParams block for the frame. Symmetry is null when
+    // every pixel has its own value.
+    void uploadFrameParams(const FractalParams& params,
+                           const Symmetry* symmetry);
+    void resolve();
+    void collectQueries();
 };
-} // namespace glFractals
\ No newline at end of file
+} // namespace glFractals
@@ -0,0 +1,161 @@
+#include "FrameReadback.hpp"
+
+#include "gl_utils.h"
+
+#include "glad/glad.h"
+
+namespace glFractals {
+
+// How long a waiting collect blocks before it checks the fence again.
+static constexpr GLuint64 WAIT_NANOSECONDS = 100000000;
+
+static auto fenceOf(void* fence) -> GLsync
+{
+    return static_cast<GLsync>(fence);
+}
+
+// Both formats take four bytes per pixel.
+static auto bufferSize(Point2D<int> size) -> GLsizeiptr
+{
+    return static_cast<GLsizeiptr>(size.x) * size.y * 4;
+}
+
+static void readInto(std::uint32_t buffer,
+                     std::uint32_t framebuffer,
+                     Point2D<int> size,
+                     GLenum format,
+                     GLenum type)
+{
+    GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer));
+    // Orphans the last contents instead of waiting until they are unused.
+    GL(glBufferData(
+        GL_PIXEL_PACK_BUFFER, bufferSize(size), nullptr, GL_STREAM_READ));
+    GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+    GL(glReadPixels(0, 0, size.x, size.y, format, type, nullptr));
+}
+
+static auto map(std::uint32_t buffer, Point2D<int> size) -> void*
+{
+    GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer));
+    GL(auto* data = glMapBufferRange(
+           GL_PIXEL_PACK_BUFFER, 0, bufferSize(size), GL_MAP_READ_BIT));
+    return data;
+}
+
+FrameReadback::FrameReadback()
+{
+    for (auto& read : reads_) {
+        GL(glGenBuffers(1, &read.colorBuffer));
+        GL(glGenBuffers(1, &read.valueBuffer));
+    }
+}
+
+FrameReadback::~FrameReadback()
+{
+    unmap();
+    for (auto& read : reads_) {
+        if (read.fence != nullptr) {
+            GL(glDeleteSync(fenceOf(read.fence)));
+        }
+        GL(glDeleteBuffers(1, &read.colorBuffer));
+        GL(glDeleteBuffers(1, &read.valueBuffer));
+    }
+}
+
+void FrameReadback::read(std::uint32_t colorFramebuffer,
+                         std::uint32_t valueFramebuffer,
+                         Point2D<int> size,
+                         const FractalParams& params,
+                         bool mirrored)
+{
+    if (size.x <= 0 || size.y <= 0) {
+        return;
+    }
+
+    auto& read = reads_[next_];
+    if (mapped_ == next_) {
+        unmap();
+    }
+    if (read.fence != nullptr) {
+        GL(glDeleteSync(fenceOf(read.fence)));
+        read.fence = nullptr;
+        dropped_++;
+    }
+
+    read.hasValues = valueFramebuffer != 0;
+    read.mirrored = read.hasValues && mirrored;
+    read.size = size;
+    read.params = params;
+
+    // Rows of four byte pixels are always aligned. The colors go last, so the
+    // read framebuffer stays the one that was drawn to.
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    if (read.hasValues) {
+        readInto(read.valueBuffer, valueFramebuffer, size, GL_RED, GL_FLOAT);
+    }
+    readInto(
+        read.colorBuffer, colorFramebuffer, size, GL_RGBA, GL_UNSIGNED_BYTE);
+    GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    GL(read.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    next_ = (next_ + 1) % NUM_READS;
+}
+
+auto FrameReadback::collect(Frame& frame, bool wait) -> bool
+{
+    unmap();
+    for (int i = 0; i < NUM_READS; i++) {
+        const auto index = (next_ + i) % NUM_READS;
+        auto& read = reads_[index];
+        if (read.fence == nullptr) {
+            continue;
+        }
+
+        // Reads finish in order, so the oldest one decides.
+        auto status = GLenum(GL_TIMEOUT_EXPIRED);
+        do {
+            GL(status = glClientWaitSync(fenceOf(read.fence),
+                                         GL_SYNC_FLUSH_COMMANDS_BIT,
+                                         wait ? WAIT_NANOSECONDS : 0));
+        } while (wait && status == GL_TIMEOUT_EXPIRED);
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+            return false;
+        }
+        GL(glDeleteSync(fenceOf(read.fence)));
+        read.fence = nullptr;
+
+        frame.params = read.params;
+        frame.size = read.size;
+        frame.mirrored = read.mirrored;
+        frame.values = read.hasValues ? static_cast<const float*>(
+                                            map(read.valueBuffer, read.size))
+                                      : nullptr;
+        frame.rgba = static_cast<const unsigned char*>(
+            map(read.colorBuffer, read.size));
+        GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        mapped_ = index;
+        return frame.rgba != nullptr &&
+               (!read.hasValues || frame.values != nullptr);
+    }
+    return false;
+}
+
+auto FrameReadback::dropped() const -> std::uint64_t { return dropped_; }
+
+void FrameReadback::unmap()
+{
+    if (mapped_ < 0) {
+        return;
+    }
+    const auto& read = reads_[mapped_];
+    GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, read.colorBuffer));
+    GL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    if (read.hasValues) {
+        GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, read.valueBuffer));
+        GL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    mapped_ = -1;
+}
+
+} // namespace glFractals
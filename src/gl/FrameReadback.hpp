@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Common.hpp"
+#include "FractalParams.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace glFractals {
+
+// Copies frames out of GL without waiting for the GPU. Every read goes into
+// pixel buffers from a small ring and is collected a few frames later, once
+// its fence says the GPU got there.
+class FrameReadback {
+public:
+    // A collected read, rows bottom up. The pointers stay valid until the
+    // next collect.
+    struct Frame {
+        FractalParams params = {};
+        Point2D<int> size = {};
+        // Four bytes per pixel.
+        const unsigned char* rgba = nullptr;
+        // One per pixel, null when the read had no values.
+        const float* values = nullptr;
+        // Set when the values of mirror copies are missing, see Symmetry.
+        bool mirrored = false;
+    };
+
+    FrameReadback();
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    // Queues reading the colors of colorFramebuffer and, unless it is 0, the
+    // single channel float values of valueFramebuffer, which skipped the
+    // mirror copies if mirrored is set. Drops the oldest read when all of
+    // them are still pending.
+    void read(std::uint32_t colorFramebuffer,
+              std::uint32_t valueFramebuffer,
+              Point2D<int> size,
+              const FractalParams& params,
+              bool mirrored);
+
+    // Takes the oldest finished read, waiting for it if wait is set. Returns
+    // false when there is none.
+    auto collect(Frame& frame, bool wait = false) -> bool;
+
+    // Reads dropped because they weren't collected in time.
+    auto dropped() const -> std::uint64_t;
+
+private:
+    static constexpr int NUM_READS = 3;
+
+    struct Read {
+        std::uint32_t colorBuffer = 0;
+        std::uint32_t valueBuffer = 0;
+        // A GLsync, kept opaque so this header needs no GL.
+        void* fence = nullptr;
+        bool hasValues = false;
+        bool mirrored = false;
+        Point2D<int> size = {};
+        FractalParams params = {};
+    };
+    Read reads_[NUM_READS];
+    // The read the next one goes into, the oldest pending one is after it.
+    int next_ = 0;
+    // The read collect mapped last, -1 for none.
+    int mapped_ = -1;
+    std::uint64_t dropped_ = 0;
+
+    void unmap();
+};
+
+} // namespace glFractals
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -14,6 +15,127 @@
 namespace glFractals {
 
 static constexpr int MIN_FONT = 12;
+// Glyphs are rasterized once at this size into a signed distance field,
+// Text.fs scales them to any other size.
+static constexpr int SDF_FONT_SIZE = 48;
+// Distance in SDF pixels where the field saturates. Glyphs get this much
+// border so their outside fades out inside the quad.
+static constexpr int SDF_SPREAD = 6;
+// Glyphs are packed in rows of this width. Leaves a gap between glyphs so
+// linear filtering never picks up a neighbour.
+static constexpr int ATLAS_WIDTH = 1024;
+static constexpr int ATLAS_PADDING = 1;
+static constexpr int FLOATS_PER_GLYPH = 6 * 4;
+
+// Squared distance transform of one row or column (Felzenszwalb and
+// Huttenlocher). f holds 0 at feature pixels and a large value elsewhere and
+// is replaced by the squared distance to the nearest feature.
+static void distanceTransform1D(std::vector<float>& f,
+                                std::vector<float>& d,
+                                std::vector<int>& v,
+                                std::vector<float>& z)
+{
+    const auto n = static_cast<int>(f.size());
+    d.resize(n);
+    v.resize(n);
+    z.resize(n + 1);
+
+    // Where the parabolas rooted at pixels q and p intersect.
+    const auto intersection = [&f](int q, int p) {
+        return ((f[q] + q * q) - (f[p] + p * p)) / (2 * q - 2 * p);
+    };
+
+    // Lower envelope of the parabolas rooted at every pixel. z[0] is minus
+    // infinity, so k never drops below 0.
+    int k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<float>::infinity();
+    z[1] = std::numeric_limits<float>::infinity();
+    for (int q = 1; q < n; q++) {
+        auto s = intersection(q, v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = intersection(q, v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = std::numeric_limits<float>::infinity();
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) {
+            k++;
+        }
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+    f = d;
+}
+
+// Returns the distance of every pixel of a width x height grid to the nearest
+// pixel where feature is set.
+static auto distanceTransform(const std::vector<bool>& feature,
+                              int width,
+                              int height) -> std::vector<float>
+{
+    // Further than any distance in the grid.
+    const auto far = static_cast<float>(width * width + height * height);
+    auto dist = std::vector<float>(feature.size());
+    for (std::size_t i = 0; i < feature.size(); i++) {
+        dist[i] = feature[i] ? 0.0f : far;
+    }
+
+    std::vector<float> line, d, z;
+    std::vector<int> v;
+    for (int x = 0; x < width; x++) {
+        line.resize(height);
+        for (int y = 0; y < height; y++) {
+            line[y] = dist[y * width + x];
+        }
+        distanceTransform1D(line, d, v, z);
+        for (int y = 0; y < height; y++) {
+            dist[y * width + x] = line[y];
+        }
+    }
+    for (int y = 0; y < height; y++) {
+        line.assign(dist.begin() + y * width, dist.begin() + (y + 1) * width);
+        distanceTransform1D(line, d, v, z);
+        std::copy(line.begin(), line.end(), dist.begin() + y * width);
+    }
+
+    for (auto& d2 : dist) {
+        d2 = std::sqrt(d2);
+    }
+    return dist;
+}
+
+// Turns a glyph coverage bitmap into a signed distance field with the edge at
+// 128, growing inward. Both have the same size.
+static auto signedDistanceField(const std::vector<unsigned char>& coverage,
+                                int width,
+                                int height) -> std::vector<unsigned char>
+{
+    auto inside = std::vector<bool>(coverage.size());
+    auto outside = std::vector<bool>(coverage.size());
+    for (std::size_t i = 0; i < coverage.size(); i++) {
+        inside[i] = coverage[i] >= 128;
+        outside[i] = !inside[i];
+    }
+    const auto toInside = distanceTransform(inside, width, height);
+    const auto toOutside = distanceTransform(outside, width, height);
+
+    auto field = std::vector<unsigned char>(coverage.size());
+    for (std::size_t i = 0; i < coverage.size(); i++) {
+        // Pixels on either side of the edge are half a pixel away from it.
+        const auto distance = inside[i] ? toOutside[i] - 0.5f
+                                        : -(toInside[i] - 0.5f);
+        const auto value = 0.5f + 0.5f * distance / SDF_SPREAD;
+        field[i] = static_cast<unsigned char>(
+            std::round(255.0f * std::min(std::max(value, 0.0f), 1.0f)));
+    }
+    return field;
+}
 
 FreeTypeWrapper::FreeTypeWrapper(const std::string& fontPath,
                                  float screenRelativeFontHeight,
@@ -31,29 +153,90 @@ FreeTypeWrapper::FreeTypeWrapper(const std::string& fontPath,
                                  fontPath);
     }
 
-    // NOTE: This assumes no other Renderer changes the OpenGL state.
-    GL(glEnable(GL_BLEND));
-    GL(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
-
-    loadCharacters(height_ * screenRelativeFontHeight_);
+    loadCharacters();
 
     GL(glGenVertexArrays(1, &vao_));
     GL(glGenBuffers(1, &vbo_));
     GL(glBindVertexArray(vao_));
     GL(glBindBuffer(GL_ARRAY_BUFFER, vbo_));
-    GL(glBufferData(
-        GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, nullptr, GL_DYNAMIC_DRAW));
     GL(glEnableVertexAttribArray(0));
     GL(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0));
 
     updateOrthoMatrix();
 }
 
-void FreeTypeWrapper::renderText(
-    Shader& shader, const std::string& text, float x, float y, float scale)
+void FreeTypeWrapper::layoutText(const std::string& text,
+                                 float x,
+                                 float y,
+                                 float scale,
+                                 std::vector<float>& vertices) const
 {
+    float dimScale = static_cast<float>(height_) / static_cast<float>(width_);
+    x *= dimScale; // Prevents the starting point to scale by width.
+
+    // The metrics are in SDF pixels.
+    scale *= fontScale();
+
+    for (auto c = text.begin(); c != text.end(); c++) {
+        const auto& ch = characters_[static_cast<unsigned char>(*c)];
+
+        // Spaces only move the pen.
+        if (ch.size.x > 0 && ch.size.y > 0) {
+            float xpos = x + ch.bearing.x * scale;
+            float ypos = y - (ch.size.y - ch.bearing.y) * scale;
+
+            float w = ch.size.x * scale;
+            float h = ch.size.y * scale;
+
+            // FreeType bitmaps are top down, so the top of the glyph is at
+            // its atlas row.
+            float u0 = static_cast<float>(ch.atlasPos.x) / atlasSize_.x;
+            float v0 = static_cast<float>(ch.atlasPos.y) / atlasSize_.y;
+            float u1 = static_cast<float>(ch.atlasPos.x + ch.size.x) /
+                       atlasSize_.x;
+            float v1 = static_cast<float>(ch.atlasPos.y + ch.size.y) /
+                       atlasSize_.y;
+
+            const float quad[6][4] = {{xpos, ypos + h, u0, v0},
+                                      {xpos, ypos, u0, v1},
+                                      {xpos + w, ypos, u1, v1},
+
+                                      {xpos, ypos + h, u0, v0},
+                                      {xpos + w, ypos, u1, v1},
+                                      {xpos + w, ypos + h, u1, v0}};
+            vertices.insert(
+                vertices.end(), &quad[0][0], &quad[0][0] + FLOATS_PER_GLYPH);
+        }
+        x += (static_cast<float>(ch.advance) / 64.0f) * scale;
+    }
+}
+
+void FreeTypeWrapper::upload(const std::vector<float>& vertices)
+{
+    GL(glBindBuffer(GL_ARRAY_BUFFER, vbo_));
+
+    // Respecifying the storage lets the driver hand out fresh memory instead
+    // of waiting for a previous frame to finish with it. Only grows, so the
+    // size settles after the first few uploads.
+    const auto size = vertices.size() * sizeof(float);
+    vboSize_ = std::max(vboSize_, size);
+    GL(glBufferData(GL_ARRAY_BUFFER, vboSize_, nullptr, GL_STREAM_DRAW));
+    GL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices.data()));
+    vertexCount_ = static_cast<int>(vertices.size() / 4);
+}
+
+void FreeTypeWrapper::draw(Shader& shader)
+{
+    if (vertexCount_ == 0) {
+        return;
+    }
+
     shader.use();
 
+    // The FractalRenderer turns blending off for its passes.
+    GL(glEnable(GL_BLEND));
+    GL(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
     // TODO: Shaders should have a matrix uniform option.
     GL(int loc = glGetUniformLocation(shader.get(), "projection"));
     // OpenGL is in column major order.
@@ -61,34 +244,9 @@ void FreeTypeWrapper::renderText(
         loc, 1, false, reinterpret_cast<float*>(orthoMatrix_)));
 
     GL(glActiveTexture(GL_TEXTURE0));
+    GL(glBindTexture(GL_TEXTURE_2D, atlasTex_));
     GL(glBindVertexArray(vao_));
-
-    float dimScale = static_cast<float>(height_) / static_cast<float>(width_);
-    x *= dimScale; // Prevents the starting point to scale by width.
-
-    for (auto c = text.begin(); c != text.end(); c++) {
-        Character ch = characters_[*c];
-
-        float xpos = x + ch.bearing.x * scale;
-        float ypos = y - (ch.size.y - ch.bearing.y) * scale;
-
-        float w = ch.size.x * scale;
-        float h = ch.size.y * scale;
-
-        float vertices[6][4] = {{xpos, ypos + h, 0.0, 0.0},
-                                {xpos, ypos, 0.0, 1.0},
-                                {xpos + w, ypos, 1.0, 1.0},
-
-                                {xpos, ypos + h, 0.0, 0.0},
-                                {xpos + w, ypos, 1.0, 1.0},
-                                {xpos + w, ypos + h, 1.0, 0.0}};
-
-        GL(glBindTexture(GL_TEXTURE_2D, ch.texID));
-        GL(glBindBuffer(GL_ARRAY_BUFFER, vbo_));
-        GL(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices));
-        GL(glDrawArrays(GL_TRIANGLES, 0, 6));
-        x += (static_cast<float>(ch.advance) / 64.0f) * scale;
-    }
+    GL(glDrawArrays(GL_TRIANGLES, 0, vertexCount_));
 }
 
 FreeTypeWrapper::~FreeTypeWrapper()
@@ -112,22 +270,21 @@ void FreeTypeWrapper::changeResolution(int width, int height)
     width_ = width;
     height_ = height;
 
-    unloadCharacters();
-    loadCharacters(height_ * screenRelativeFontHeight_);
+    // The distance field scales, so only the projection changes.
     updateOrthoMatrix();
 }
 
-void FreeTypeWrapper::loadCharacters(int font)
+void FreeTypeWrapper::loadCharacters()
 {
     unloadCharacters();
 
-    FT_Set_Pixel_Sizes(ftFace_, 0, std::max(font, MIN_FONT));
-
-    // OpenGL requires textures to be 4byte aligned, but FreeType will use 1byte
-    // textures (single channel). Therefore, we need to edit the alignment.
-    GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    FT_Set_Pixel_Sizes(ftFace_, 0, SDF_FONT_SIZE);
 
+    // Pack the glyphs in rows, each as high as its highest glyph.
+    std::vector<std::vector<unsigned char>> bitmaps(NUM_CHARACTERS);
     characters_.resize(NUM_CHARACTERS);
+    auto pen = Point2D<int>(ATLAS_PADDING, ATLAS_PADDING);
+    int rowHeight = 0;
     for (int c = 0; c < NUM_CHARACTERS; c++) {
         if (FT_Load_Char(ftFace_, c, FT_LOAD_RENDER)) {
             std::stringstream ss;
@@ -135,46 +292,91 @@ void FreeTypeWrapper::loadCharacters(int font)
             throw std::runtime_error(ss.str());
         }
 
-        GLuint tex;
-        GL(glGenTextures(1, &tex));
-        GL(glBindTexture(GL_TEXTURE_2D, tex));
-        GL(glTexImage2D(GL_TEXTURE_2D,                   // target
-                        0,                               // level (LOD)
-                        GL_RED,                          // internal format
-                        ftFace_->glyph->bitmap.width,    // width
-                        ftFace_->glyph->bitmap.rows,     // height
-                        0,                               // border (must be 0)
-                        GL_RED,                          // format
-                        GL_UNSIGNED_BYTE,                // type
-                        ftFace_->glyph->bitmap.buffer)); // buf
-
-        GL(glTexParameteri(
-            GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER));
-        GL(glTexParameteri(
-            GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER));
-        GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        // Blank glyphs like space only move the pen.
+        const auto& bitmap = ftFace_->glyph->bitmap;
+        const auto blank = bitmap.width == 0 || bitmap.rows == 0;
+        const auto border = blank ? 0 : SDF_SPREAD;
+        const auto width =
+            std::min(static_cast<int>(bitmap.width) + 2 * border,
+                     ATLAS_WIDTH - 2 * ATLAS_PADDING);
+        const auto rows = static_cast<int>(bitmap.rows) + 2 * border;
+        if (pen.x + width + ATLAS_PADDING > ATLAS_WIDTH) {
+            pen = {ATLAS_PADDING, pen.y + rowHeight + ATLAS_PADDING};
+            rowHeight = 0;
+        }
+
+        // Copy the rows into the middle of the border, they can be padded to
+        // pitch bytes.
+        auto coverage =
+            std::vector<unsigned char>(static_cast<std::size_t>(width) * rows);
+        const auto copyWidth = std::max(0, width - 2 * border);
+        for (int row = 0; row < static_cast<int>(bitmap.rows); row++) {
+            std::copy(bitmap.buffer + row * bitmap.pitch,
+                      bitmap.buffer + row * bitmap.pitch + copyWidth,
+                      coverage.begin() + (row + border) * width + border);
+        }
+        if (!blank) {
+            bitmaps[c] = signedDistanceField(coverage, width, rows);
+        }
 
         characters_[c] = {
-            tex,
-            Point2D<int>(ftFace_->glyph->bitmap.width,
-                         ftFace_->glyph->bitmap.rows),
-            Point2D<int>(ftFace_->glyph->bitmap_left,
-                         ftFace_->glyph->bitmap_top),
+            pen,
+            blank ? Point2D<int>() : Point2D<int>(width, rows),
+            Point2D<int>(ftFace_->glyph->bitmap_left - border,
+                         ftFace_->glyph->bitmap_top + border),
             static_cast<std::uint32_t>(ftFace_->glyph->advance.x)};
 
         maxBearingY_ = std::max(maxBearingY_,
                                 static_cast<float>(ftFace_->glyph->bitmap_top));
+
+        if (!blank) {
+            pen.x += width + ATLAS_PADDING;
+            rowHeight = std::max(rowHeight, rows);
+        }
     }
+    atlasSize_ = {ATLAS_WIDTH, pen.y + rowHeight + ATLAS_PADDING};
+
+    auto atlas = std::vector<unsigned char>(
+        static_cast<std::size_t>(atlasSize_.x) * atlasSize_.y, 0);
+    for (int c = 0; c < NUM_CHARACTERS; c++) {
+        const auto& ch = characters_[c];
+        for (int row = 0; row < ch.size.y; row++) {
+            std::copy(bitmaps[c].begin() + row * ch.size.x,
+                      bitmaps[c].begin() + (row + 1) * ch.size.x,
+                      atlas.begin() +
+                          static_cast<std::size_t>(ch.atlasPos.y + row) *
+                              atlasSize_.x +
+                          ch.atlasPos.x);
+        }
+    }
+
+    // OpenGL requires textures to be 4byte aligned, but FreeType will use 1byte
+    // textures (single channel). Therefore, we need to edit the alignment.
+    GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+    GL(glGenTextures(1, &atlasTex_));
+    GL(glBindTexture(GL_TEXTURE_2D, atlasTex_));
+    GL(glTexImage2D(GL_TEXTURE_2D,     // target
+                    0,                 // level (LOD)
+                    GL_RED,            // internal format
+                    atlasSize_.x,      // width
+                    atlasSize_.y,      // height
+                    0,                 // border (must be 0)
+                    GL_RED,            // format
+                    GL_UNSIGNED_BYTE,  // type
+                    atlas.data()));    // buf
+
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 }
 
 void FreeTypeWrapper::unloadCharacters()
 {
-    for (auto& ch: characters_) {
-        if (ch.texID != 0) {
-            GL(glDeleteTextures(1, &ch.texID));
-            ch.texID = 0;
-        }
+    if (atlasTex_ != 0) {
+        GL(glDeleteTextures(1, &atlasTex_));
+        atlasTex_ = 0;
     }
     maxBearingY_ = std::numeric_limits<float>::min();
 }
@@ -184,7 +386,18 @@ auto FreeTypeWrapper::screenRelativeFontHeight() -> float
     return screenRelativeFontHeight_;
 }
 
-auto FreeTypeWrapper::maxBearingY() -> float { return maxBearingY_; }
+auto FreeTypeWrapper::maxBearingY() -> float
+{
+    return maxBearingY_ * fontScale();
+}
+
+auto FreeTypeWrapper::fontScale() const -> float
+{
+    const auto font =
+        std::max(static_cast<int>(height_ * screenRelativeFontHeight_),
+                 MIN_FONT);
+    return static_cast<float>(font) / SDF_FONT_SIZE;
+}
 
 void FreeTypeWrapper::updateOrthoMatrix()
 {
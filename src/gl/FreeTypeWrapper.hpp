@@ -21,8 +21,18 @@ public:
                     int resHeight);
     ~FreeTypeWrapper();
 
-    void renderText(
-        Shader& shader, const std::string& text, float x, float y, float scale);
+    // Appends the quads of text to vertices, two triangles of x, y, u, v
+    // vertices per glyph. The baseline starts at x, y in pixels from the
+    // bottom left.
+    void layoutText(const std::string& text,
+                    float x,
+                    float y,
+                    float scale,
+                    std::vector<float>& vertices) const;
+    // Replaces the vertices draw uses.
+    void upload(const std::vector<float>& vertices);
+    // Draws the uploaded text in one call.
+    void draw(Shader& shader);
 
     void changeResolution(Point2D<int> resolution);
     void changeResolution(int width, int height);
@@ -35,10 +45,19 @@ public:
 private:
     std::uint32_t vao_ = 0;
     std::uint32_t vbo_ = 0;
+    // Bytes the vertex buffer has room for.
+    std::size_t vboSize_ = 0;
+    int vertexCount_ = 0;
+
+    // Every glyph packed into a single texture, so all text shares one draw.
+    // Holds signed distance fields rather than coverage, see Text.fs.
+    std::uint32_t atlasTex_ = 0;
+    Point2D<int> atlasSize_ = {};
 
     FT_Library ftLibrary_ = nullptr;
     FT_Face ftFace_ = nullptr;
 
+    // In atlas pixels, see fontScale.
     float maxBearingY_ = std::numeric_limits<float>::min();
 
     float screenRelativeFontHeight_;
@@ -47,7 +66,8 @@ private:
     float orthoMatrix_[4][4] = {};
 
     struct Character {
-        std::uint32_t texID = 0;
+        // Top left corner of the glyph in the atlas.
+        Point2D<int> atlasPos = {};
         Point2D<int> size = {};
         Point2D<int> bearing = {};
         std::uint32_t advance = 0;
@@ -56,9 +76,13 @@ private:
     static constexpr int NUM_CHARACTERS = 256;
     std::vector<Character> characters_;
 
-    void loadCharacters(int font);
+    // Rasterizes every glyph once into the distance field atlas.
+    void loadCharacters();
     void unloadCharacters();
 
+    // Font size for the current resolution over the atlas font size.
+    auto fontScale() const -> float;
+
     void updateOrthoMatrix();
 };
 
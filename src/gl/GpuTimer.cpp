@@ -0,0 +1,56 @@
+#include "GpuTimer.hpp"
+
+#include "gl_utils.h"
+
+#include "glad/glad.h"
+
+namespace glFractals {
+
+GpuTimer::GpuTimer()
+{
+    GL(glGenQueries(2 * NUM_QUERIES, &queries_[0][0]));
+}
+
+GpuTimer::~GpuTimer() { GL(glDeleteQueries(2 * NUM_QUERIES, &queries_[0][0])); }
+
+void GpuTimer::begin()
+{
+    // Reuses the oldest measurement when all of them are still pending.
+    GL(glQueryCounter(queries_[next_][0], GL_TIMESTAMP));
+}
+
+void GpuTimer::end()
+{
+    GL(glQueryCounter(queries_[next_][1], GL_TIMESTAMP));
+    pending_[next_] = true;
+    next_ = (next_ + 1) % NUM_QUERIES;
+}
+
+auto GpuTimer::collect(float& seconds) -> bool
+{
+    for (int i = 0; i < NUM_QUERIES; i++) {
+        const auto query = (next_ + i) % NUM_QUERIES;
+        if (!pending_[query]) {
+            continue;
+        }
+
+        // The end timestamp finishes last.
+        GLuint available = 0;
+        GL(glGetQueryObjectuiv(
+            queries_[query][1], GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available) {
+            return false;
+        }
+
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        GL(glGetQueryObjectui64v(queries_[query][0], GL_QUERY_RESULT, &start));
+        GL(glGetQueryObjectui64v(queries_[query][1], GL_QUERY_RESULT, &end));
+        pending_[query] = false;
+        seconds = (end - start) * 1e-9f;
+        return true;
+    }
+    return false;
+}
+
+} // namespace glFractals
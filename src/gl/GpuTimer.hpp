@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+namespace glFractals {
+
+// Measures how long the GPU takes for the commands between begin and end.
+// Results are read a few frames late from a ring of queries, so measuring
+// never waits on the GPU. Uses timestamp pairs rather than GL_TIME_ELAPSED,
+// whose queries can't nest with the one FractalRenderer keeps around its value
+// pass.
+class GpuTimer {
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void begin();
+    void end();
+
+    // Takes the oldest finished measurement. Returns false when there is
+    // none yet.
+    auto collect(float& seconds) -> bool;
+
+private:
+    static constexpr int NUM_QUERIES = 4;
+    // Start and end timestamp of every measurement.
+    std::uint32_t queries_[NUM_QUERIES][2] = {};
+    bool pending_[NUM_QUERIES] = {};
+    // The measurement begin writes, the oldest pending one is after it.
+    int next_ = 0;
+};
+
+} // namespace glFractals
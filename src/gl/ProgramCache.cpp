@@ -0,0 +1,276 @@
+#include "ProgramCache.hpp"
+
+#include "gl_utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// From GL_ARB_get_program_binary, which glad doesn't load for GL 3.3.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_PROGRAM_BINARY_FORMATS
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+
+namespace glFractals {
+
+static constexpr std::uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+static constexpr std::uint64_t FNV_PRIME = 0x100000001b3;
+// Bump when the file layout changes.
+static constexpr char FILE_MAGIC[4] = {'G', 'F', 'P', '1'};
+
+namespace {
+struct FileHeader {
+    char magic[4];
+    std::uint32_t format;
+    std::uint32_t length;
+};
+} // namespace
+
+// Creates directory and its parents. Returns false when it doesn't exist
+// afterwards.
+static auto makeDirectories(const std::string& directory) -> bool
+{
+    auto pos = std::size_t(0);
+    do {
+        pos = directory.find('/', pos + 1);
+        const auto part = directory.substr(0, pos);
+#ifdef _WIN32
+        _mkdir(part.c_str());
+#else
+        mkdir(part.c_str(), 0755);
+#endif
+    } while (pos != std::string::npos);
+
+    std::ofstream probe(directory + "/.probe");
+    const auto writable = probe.good();
+    probe.close();
+    std::remove((directory + "/.probe").c_str());
+    return writable;
+}
+
+static auto hasProgramBinary() -> bool
+{
+    GLint major = 0;
+    GLint minor = 0;
+    GL(glGetIntegerv(GL_MAJOR_VERSION, &major));
+    GL(glGetIntegerv(GL_MINOR_VERSION, &minor));
+    if (major > 4 || (major == 4 && minor >= 1)) {
+        return true;
+    }
+
+    return hasGLExtension("GL_ARB_get_program_binary");
+}
+
+static auto glString(GLenum name) -> std::string
+{
+    GL(auto str = glGetString(name));
+    return str != nullptr ? reinterpret_cast<const char*>(str) : "";
+}
+
+ProgramCache::ProgramCache(const std::string& directory, GLADloadproc loadProc)
+{
+    if (directory.empty() || !hasProgramBinary()) {
+        return;
+    }
+
+    getProgramBinary_ =
+        reinterpret_cast<GetProgramBinaryProc>(loadProc("glGetProgramBinary"));
+    programBinary_ =
+        reinterpret_cast<ProgramBinaryProc>(loadProc("glProgramBinary"));
+    programParameteri_ = reinterpret_cast<ProgramParameteriProc>(
+        loadProc("glProgramParameteri"));
+    if (getProgramBinary_ == nullptr || programBinary_ == nullptr ||
+        programParameteri_ == nullptr) {
+        return;
+    }
+
+    GLint numFormats = 0;
+    GL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats));
+    if (numFormats <= 0 || !makeDirectories(directory)) {
+        return;
+    }
+    formats_.resize(numFormats);
+    GL(glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats_.data()));
+
+    directory_ = directory;
+    driver_ = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" +
+              glString(GL_VERSION);
+}
+
+auto ProgramCache::enabled() const -> bool { return !directory_.empty(); }
+
+auto ProgramCache::key(const std::vector<std::string>& sources) const
+    -> std::string
+{
+    // FNV-1a, with a terminating zero per string so moving text from one
+    // source to the next changes the key.
+    auto hash = FNV_OFFSET_BASIS;
+    auto add = [&hash](const std::string& str) {
+        for (const auto c : str) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+        }
+        hash *= FNV_PRIME;
+    };
+    add(driver_);
+    for (const auto& source : sources) {
+        add(source);
+    }
+
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return ss.str();
+}
+
+auto ProgramCache::path(const std::string& key) const -> std::string
+{
+    return directory_ + "/" + key + ".bin";
+}
+
+auto ProgramCache::load(const std::string& key) -> GLuint
+{
+    if (!enabled()) {
+        return 0;
+    }
+
+    std::ifstream file(path(key), std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+
+    // Formats the driver no longer lists would be a GL error, not just a
+    // failed link.
+    auto header = FileHeader();
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    const auto knownFormat =
+        std::find(formats_.begin(),
+                  formats_.end(),
+                  static_cast<GLint>(header.format)) != formats_.end();
+    auto data = std::vector<char>();
+    if (file && knownFormat &&
+        std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0) {
+        data.resize(header.length);
+        file.read(data.data(), header.length);
+    }
+    if (!file || data.empty()) {
+        file.close();
+        std::remove(path(key).c_str());
+        rejected_++;
+        return 0;
+    }
+
+    GL(auto program = glCreateProgram());
+    GL(programBinary_(program,
+                      header.format,
+                      data.data(),
+                      static_cast<GLsizei>(data.size())));
+    int success;
+    GL(glGetProgramiv(program, GL_LINK_STATUS, &success));
+    if (!success) {
+        // Usually a driver update, compiling from source replaces it.
+        GL(glDeleteProgram(program));
+        file.close();
+        std::remove(path(key).c_str());
+        rejected_++;
+        return 0;
+    }
+
+    loaded_++;
+    return program;
+}
+
+void ProgramCache::prepare(GLuint program)
+{
+    if (enabled()) {
+        GL(programParameteri_(
+            program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+}
+
+void ProgramCache::store(const std::string& key, GLuint program)
+{
+    compiled_++;
+    if (!enabled()) {
+        return;
+    }
+
+    GLint length = 0;
+    GL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0) {
+        return;
+    }
+
+    auto data = std::vector<char>(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    GL(getProgramBinary_(program, length, &written, &format, data.data()));
+
+    auto header = FileHeader();
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.format = format;
+    header.length = static_cast<std::uint32_t>(written);
+
+    // Written next to the entry and renamed, so a concurrent launch never
+    // reads half a file.
+    const auto tmpPath = path(key) + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), written);
+        if (!file) {
+            file.close();
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    std::remove(path(key).c_str());
+    std::rename(tmpPath.c_str(), path(key).c_str());
+}
+
+auto ProgramCache::stateStrings() const -> std::vector<std::string>
+{
+    std::stringstream ss;
+    if (enabled()) {
+        ss << "shader cache: " << loaded_ << " programs loaded, " << compiled_
+           << " compiled, " << rejected_ << " rejected";
+    }
+    else {
+        ss << "shader cache: off";
+    }
+    return {ss.str()};
+}
+
+auto ProgramCache::defaultDirectory() -> std::string
+{
+    if (const auto* xdg = std::getenv("XDG_CACHE_HOME")) {
+        if (xdg[0] != '\0') {
+            return std::string(xdg) + "/glFractals";
+        }
+    }
+    if (const auto* home = std::getenv("HOME")) {
+        if (home[0] != '\0') {
+            return std::string(home) + "/.cache/glFractals";
+        }
+    }
+    return "";
+}
+
+} // namespace glFractals
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// Caches linked programs on disk with glGetProgramBinary, so only the first
+// launch with a given driver compiles the shaders. Entries are keyed by a hash
+// of the sources and the driver strings, so changing either just misses.
+class ProgramCache {
+public:
+    // GL 3.3 doesn't have program binaries, so their entry points are loaded
+    // with loadProc. The cache stays disabled when the driver lacks
+    // GL_ARB_get_program_binary or has no binary formats, or when directory
+    // is empty.
+    ProgramCache(const std::string& directory, GLADloadproc loadProc);
+
+    auto enabled() const -> bool;
+
+    // Hashes everything the binary depends on.
+    auto key(const std::vector<std::string>& sources) const -> std::string;
+
+    // Returns the cached program for key, or 0 when there is none or the
+    // driver rejects it. Rejected entries are removed.
+    auto load(const std::string& key) -> GLuint;
+    // Call before linking a program that will be stored.
+    void prepare(GLuint program);
+    void store(const std::string& key, GLuint program);
+
+    // Returns where the programs of this run came from.
+    auto stateStrings() const -> std::vector<std::string>;
+
+    // Per user cache directory, empty when the environment has none.
+    static auto defaultDirectory() -> std::string;
+
+private:
+    using GetProgramBinaryProc =
+        void(APIENTRYP)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    using ProgramBinaryProc =
+        void(APIENTRYP)(GLuint, GLenum, const void*, GLsizei);
+    using ProgramParameteriProc = void(APIENTRYP)(GLuint, GLenum, GLint);
+
+    std::string directory_;
+    std::string driver_;
+    std::vector<GLint> formats_;
+
+    GetProgramBinaryProc getProgramBinary_ = nullptr;
+    ProgramBinaryProc programBinary_ = nullptr;
+    ProgramParameteriProc programParameteri_ = nullptr;
+
+    int loaded_ = 0;
+    int compiled_ = 0;
+    int rejected_ = 0;
+
+    auto path(const std::string& key) const -> std::string;
+};
+
+} // namespace glFractals
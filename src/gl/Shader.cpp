@@ -1,25 +1,51 @@
 #include "Shader.hpp"
 
+#include "ProgramCache.hpp"
 #include "Utils.hpp"
 #include "gl_utils.h"
 
 #include "glad/glad.h"
 
 #include <cassert>
+#include <string>
 #include <iostream>
 #include <sstream>
 
 namespace glFractals {
 
-Shader::Shader(const std::vector<Shader::Source>& sources)
-    : program_([&]() {
-          std::vector<Shader::ObjectWrapper> objs;
-          for (auto& src : sources) {
-              objs.emplace_back(src);
-          }
-          return objs;
-      }())
+Shader::Shader(const std::vector<Shader::Source>& sources, ProgramCache* cache)
 {
+    // The cache key needs the code anyway, so read every file once here.
+    auto loaded = sources;
+    for (auto& src : loaded) {
+        if (src.code.empty()) {
+            src.code = fileToString(src.path);
+        }
+    }
+
+    auto key = std::string();
+    if (cache != nullptr && cache->enabled()) {
+        std::vector<std::string> keySources;
+        for (const auto& src : loaded) {
+            keySources.push_back(
+                std::to_string(static_cast<std::uint32_t>(src.type)) + "\n" +
+                src.code);
+        }
+        key = cache->key(keySources);
+        program_.program = cache->load(key);
+        if (program_.program != 0) {
+            return;
+        }
+    }
+
+    std::vector<Shader::ObjectWrapper> objs;
+    for (auto& src : loaded) {
+        objs.emplace_back(src);
+    }
+    program_ = ProgramWrapper(objs, cache);
+    if (!key.empty()) {
+        cache->store(key, program_.program);
+    }
 }
 
 Shader::Shader(Shader&& other) : program_(std::move(other.program_)) {}
@@ -47,13 +73,30 @@ void Shader::setUniform_impl(const GLint location, const float value)
     GL(glUniform1f(location, value));
 }
 
+void Shader::setUniform_impl(const GLint location,
+                             const Point2D<float>& value)
+{
+    GL(glUniform2f(location, value.x, value.y));
+}
+
+auto Shader::bindUniformBlock(const char* name, GLuint binding) -> bool
+{
+    GL(const auto index = glGetUniformBlockIndex(program_.program, name));
+    if (index == GL_INVALID_INDEX) {
+        return false;
+    }
+    GL(glUniformBlockBinding(program_.program, index, binding));
+    return true;
+}
+
 Shader::Program Shader::get() const { return program_.program; }
 
 void Shader::use() { GL(glUseProgram(program_.program)); }
 
 Shader::ObjectWrapper::ObjectWrapper(const Shader::Source& source)
 {
-    auto shaderSrc = fileToString(source.path);
+    auto shaderSrc =
+        source.code.empty() ? fileToString(source.path) : source.code;
 
     GL(object = glCreateShader(static_cast<std::uint32_t>(source.type)));
     assert(object != 0);
@@ -95,12 +138,16 @@ operator=(Shader::ObjectWrapper&& other)
 Shader::ObjectWrapper::~ObjectWrapper() { GL(glDeleteShader(object)); }
 
 Shader::ProgramWrapper::ProgramWrapper(
-    const std::vector<Shader::ObjectWrapper>& objects)
+    const std::vector<Shader::ObjectWrapper>& objects,
+    ProgramCache* cache)
 {
     program = glCreateProgram();
     for (auto& obj : objects) {
         GL(glAttachShader(program, obj.object));
     }
+    if (cache != nullptr) {
+        cache->prepare(program);
+    }
     GL(glLinkProgram(program));
 
     int success;
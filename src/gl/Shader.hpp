@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Common.hpp"
+
 #include "glad/glad.h"
 
 #include <cstdint>
@@ -7,6 +9,24 @@
 #include <vector>
 
 namespace glFractals {
+class ProgramCache;
+
+// A uniform location looked up once after linking, so setting it every frame
+// costs no string or driver lookup. Uniforms the program doesn't use have
+// location -1, which OpenGL ignores. Set it while the program is in use.
+template <typename T>
+class Uniform {
+public:
+    Uniform() = default;
+    explicit Uniform(GLint location) : location_(location) {}
+
+    void set(const T& value) const;
+    auto location() const -> GLint { return location_; }
+
+private:
+    GLint location_ = -1;
+};
+
 class Shader {
 public:
     using Program = std::uint32_t;
@@ -17,9 +37,13 @@ public:
         };
         Type type;
         std::string path;
+        // Generated source used instead of reading path when not empty.
+        std::string code = {};
     };
 
-    Shader(const std::vector<Source>& sources);
+    // Loads the program from cache when it has it, otherwise compiles the
+    // sources and adds the result.
+    Shader(const std::vector<Source>& sources, ProgramCache* cache = nullptr);
     Shader(Shader&&);
     Shader& operator=(Shader&&);
     Shader(const Shader&) = delete;
@@ -30,7 +54,20 @@ public:
     auto get() const -> Program;
     void use();
 
+    // Returns the handle of a uniform, see Uniform.
+    template <typename T>
+    auto uniform(const char* name) const -> Uniform<T>
+    {
+        return Uniform<T>(glGetUniformLocation(program_.program, name));
+    }
+
+    // Makes the uniform block read from the buffer bound to binding. Returns
+    // false if the program has no such block.
+    auto bindUniformBlock(const char* name, GLuint binding) -> bool;
+
     // For error checking. Returns false if the uniform name is not found.
+    // Looks the location up on every call, use uniform for values set every
+    // frame.
     template <typename T>
     auto setUniform(const std::string& name, const T& value)
     {
@@ -43,6 +80,9 @@ public:
     }
 
 private:
+    template <typename T>
+    friend class Uniform;
+
     using Object = std::uint32_t;
 
     // Helper openGL intermediate class for RAII
@@ -58,7 +98,8 @@ private:
     // Helper openGL intermediate class for RAII
     struct ProgramWrapper {
         ProgramWrapper() = default;
-        ProgramWrapper(const std::vector<ObjectWrapper>& objects);
+        ProgramWrapper(const std::vector<ObjectWrapper>& objects,
+                       ProgramCache* cache);
         ProgramWrapper(ProgramWrapper&&);
         ProgramWrapper& operator=(ProgramWrapper&&);
         ~ProgramWrapper();
@@ -67,13 +108,21 @@ private:
     };
 
     // These do the actual OpenGL calls.
-    void setUniform_impl(const GLint location, const bool value);
-    void setUniform_impl(const GLint location, const int value);
-    void setUniform_impl(const GLint location, const float value);
+    static void setUniform_impl(const GLint location, const bool value);
+    static void setUniform_impl(const GLint location, const int value);
+    static void setUniform_impl(const GLint location, const float value);
+    static void setUniform_impl(const GLint location,
+                                const Point2D<float>& value);
     // Double requires #version 400.
     // void SetUniform_core(const GLint location, const double value) const;
 
     ProgramWrapper program_;
 };
 
+template <typename T>
+void Uniform<T>::set(const T& value) const
+{
+    Shader::setUniform_impl(location_, value);
+}
+
 } // namespace glFractals
\ No newline at end of file
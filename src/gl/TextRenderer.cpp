@@ -34,7 +34,7 @@ TextRenderer::TextRenderer(Shader& shader,
 {
 }
 
-void TextRenderer::render(const std::vector<std::string> stateStrings)
+void TextRenderer::render(const HudText& hud)
 {
     const float bottomPadding =
         0.1 * height_ * freeTyper_.screenRelativeFontHeight();
@@ -44,10 +44,37 @@ void TextRenderer::render(const std::vector<std::string> stateStrings)
 
     float textPosY = height_;
 
-    for (const auto& str : stateStrings) {
+    // Line positions only depend on the line number, so a line keeps its
+    // vertices until its text changes.
+    auto changed = layoutStale_ || hud.size() != numLines_;
+    for (std::size_t i = 0; i < hud.size(); i++) {
         textPosY -= (maxBearingY + topPadding + bottomPadding);
-        freeTyper_.renderText(shader_, str, leftPadding, textPosY, 1.0f);
+        if (i == lines_.size()) {
+            lines_.emplace_back();
+        }
+
+        auto& line = lines_[i];
+        if (layoutStale_ || line.text != hud.line(i)) {
+            line.text = hud.line(i);
+            line.vertices.clear();
+            freeTyper_.layoutText(
+                line.text, leftPadding, textPosY, 1.0f, line.vertices);
+            changed = true;
+        }
+    }
+    numLines_ = hud.size();
+    layoutStale_ = false;
+
+    if (changed) {
+        vertices_.clear();
+        for (std::size_t i = 0; i < numLines_; i++) {
+            vertices_.insert(vertices_.end(),
+                             lines_[i].vertices.begin(),
+                             lines_[i].vertices.end());
+        }
+        freeTyper_.upload(vertices_);
     }
+    freeTyper_.draw(shader_);
 }
 
 void TextRenderer::changeResolution(int newWidth, int newHeight)
@@ -57,6 +84,7 @@ void TextRenderer::changeResolution(int newWidth, int newHeight)
 
     GL(glViewport(0, 0, width_, height_));
     freeTyper_.changeResolution(width_, height_);
+    layoutStale_ = true;
 }
 
 void TextRenderer::changeResolution(const Point2D<int> newResolution)
@@ -2,9 +2,12 @@
 
 #include "Common.hpp"
 #include "FreeTypeWrapper.hpp"
+#include "HudText.hpp"
 #include "ResolutionChangeListener.hpp"
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 namespace glFractals {
 class Shader;
@@ -22,7 +25,9 @@ public:
 
     virtual ~TextRenderer();
 
-    void render(const std::vector<std::string> stateStrings);
+    // Draws the lines top down from the top left corner. Only lines whose
+    // text changed since the last call are laid out again.
+    void render(const HudText& hud);
 
     // Changes the resolution of the rendering.
     void changeResolution(int newWidth, int newHeight);
@@ -38,5 +43,18 @@ private:
     int height_ = 0;
 
     FreeTypeWrapper freeTyper_;
+
+    // What the last render drew, kept to skip lines that didn't change.
+    struct Line {
+        std::string text;
+        std::vector<float> vertices;
+    };
+    // Lines past numLines_ are left over from frames with more lines.
+    std::vector<Line> lines_;
+    std::size_t numLines_ = 0;
+    // Set when a resize moved every line.
+    bool layoutStale_ = true;
+    // All lines in one buffer for the upload.
+    std::vector<float> vertices_;
 };
 } // namespace glFractals
\ No newline at end of file
@@ -1,13 +1,16 @@
 #ifndef GL_UTILS_H
 #define GL_UTILS_H
 
-// Turn off to not assert.
-#define USE_GL_ASSERT
+// GL() checks glGetError after every call when USE_GL_ASSERT is defined.
+// That stalls some drivers, so only checked builds define it (cmake
+// -DGL_ASSERT=ON, or a Debug build). --gl-debug reports errors from the
+// driver's debug output without the per call cost.
 
 #include "glad/glad.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 inline void handleGLError(int line, const char* file, const char* func)
 {
@@ -57,4 +60,18 @@ inline void handleGLError(int line, const char* file, const char* func)
 #define GL(arg) arg
 #endif
 
+// Returns whether the context lists the extension.
+inline bool hasGLExtension(const char* extension)
+{
+    GLint extensions = 0;
+    GL(glGetIntegerv(GL_NUM_EXTENSIONS, &extensions));
+    for (GLint i = 0; i < extensions; i++) {
+        GL(const GLubyte* name = glGetStringi(GL_EXTENSIONS, i));
+        if (strcmp((const char*)name, extension) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 #endif // #ifndef GL_UTILS_H
@@ -0,0 +1,276 @@
+#include "Socket.hpp"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace glFractals {
+
+static const std::string UNIX_PREFIX = "unix:";
+
+// Keeps writes to closed connections from raising SIGPIPE.
+#ifdef MSG_NOSIGNAL
+static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static constexpr int SEND_FLAGS = 0;
+#endif
+
+static auto errorString(const std::string& what) -> std::string
+{
+    return what + ": " + std::strerror(errno);
+}
+
+static auto isUnix(const std::string& address) -> bool
+{
+    return address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0;
+}
+
+static auto unixAddress(const std::string& address) -> sockaddr_un
+{
+    const auto path = address.substr(UNIX_PREFIX.size());
+    auto addr = sockaddr_un();
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("invalid socket path in " + address);
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// Resolves HOST:PORT, an empty host or * listens on every interface.
+static auto resolve(const std::string& address, bool passive) -> addrinfo*
+{
+    const auto colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::runtime_error("expected HOST:PORT or unix:PATH, got " +
+                                 address);
+    }
+    auto host = address.substr(0, colon);
+    const auto port = address.substr(colon + 1);
+    if (host == "*") {
+        host.clear();
+    }
+
+    auto hints = addrinfo();
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo* result = nullptr;
+    const auto error = getaddrinfo(
+        host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result);
+    if (error != 0) {
+        throw std::runtime_error("failed to resolve " + address + ": " +
+                                 gai_strerror(error));
+    }
+    return result;
+}
+
+static void setNoSigPipe(int fd)
+{
+#ifdef SO_NOSIGPIPE
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)fd;
+#endif
+}
+
+Socket::Socket(int fd) : fd_(fd) { setNoSigPipe(fd_); }
+
+Socket::~Socket() { close(); }
+
+Socket::Socket(Socket&& other)
+    : fd_(other.fd_), unixPath_(std::move(other.unixPath_))
+{
+    other.fd_ = -1;
+    other.unixPath_.clear();
+}
+
+Socket& Socket::operator=(Socket&& other)
+{
+    if (this != &other) {
+        close();
+        fd_ = other.fd_;
+        unixPath_ = std::move(other.unixPath_);
+        other.fd_ = -1;
+        other.unixPath_.clear();
+    }
+    return *this;
+}
+
+auto Socket::listen(const std::string& address) -> Socket
+{
+    if (isUnix(address)) {
+        const auto addr = unixAddress(address);
+        auto socket = Socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!socket.valid()) {
+            throw std::runtime_error(errorString("socket"));
+        }
+        unlink(addr.sun_path);
+        if (bind(socket.fd_,
+                 reinterpret_cast<const sockaddr*>(&addr),
+                 sizeof(addr)) != 0 ||
+            ::listen(socket.fd_, SOMAXCONN) != 0) {
+            throw std::runtime_error(errorString("failed to listen on " +
+                                                 address));
+        }
+        socket.unixPath_ = addr.sun_path;
+        return socket;
+    }
+
+    auto* info = resolve(address, true);
+    for (auto* ai = info; ai != nullptr; ai = ai->ai_next) {
+        auto socket =
+            Socket(::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+        if (!socket.valid()) {
+            continue;
+        }
+        // Restarted coordinators can take the port again right away.
+        const int on = 1;
+        setsockopt(socket.fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(socket.fd_, ai->ai_addr, ai->ai_addrlen) == 0 &&
+            ::listen(socket.fd_, SOMAXCONN) == 0) {
+            freeaddrinfo(info);
+            return socket;
+        }
+    }
+    freeaddrinfo(info);
+    throw std::runtime_error(errorString("failed to listen on " + address));
+}
+
+auto Socket::connect(const std::string& address) -> Socket
+{
+    if (isUnix(address)) {
+        const auto addr = unixAddress(address);
+        auto socket = Socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!socket.valid()) {
+            throw std::runtime_error(errorString("socket"));
+        }
+        if (::connect(socket.fd_,
+                      reinterpret_cast<const sockaddr*>(&addr),
+                      sizeof(addr)) != 0) {
+            throw std::runtime_error(errorString("failed to connect to " +
+                                                 address));
+        }
+        return socket;
+    }
+
+    auto* info = resolve(address, false);
+    for (auto* ai = info; ai != nullptr; ai = ai->ai_next) {
+        auto socket =
+            Socket(::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+        if (!socket.valid()) {
+            continue;
+        }
+        if (::connect(socket.fd_, ai->ai_addr, ai->ai_addrlen) == 0) {
+            freeaddrinfo(info);
+            // Messages are small and answered one by one, don't hold them
+            // back.
+            const int on = 1;
+            setsockopt(
+                socket.fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            return socket;
+        }
+    }
+    freeaddrinfo(info);
+    throw std::runtime_error(errorString("failed to connect to " + address));
+}
+
+auto Socket::accept() -> Socket
+{
+    for (;;) {
+        const auto fd = ::accept(fd_, nullptr, nullptr);
+        if (fd >= 0) {
+            const int on = 1;
+            // Fails harmlessly on Unix sockets.
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            return Socket(fd);
+        }
+        if (errno != EINTR) {
+            throw std::runtime_error(errorString("accept"));
+        }
+    }
+}
+
+auto Socket::valid() const -> bool { return fd_ >= 0; }
+
+auto Socket::fd() const -> int { return fd_; }
+
+void Socket::close()
+{
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (!unixPath_.empty()) {
+        unlink(unixPath_.c_str());
+        unixPath_.clear();
+    }
+}
+
+static auto peerGone(int error) -> bool
+{
+    return error == EPIPE || error == ECONNRESET || error == ECONNABORTED ||
+           error == ETIMEDOUT;
+}
+
+auto Socket::send(const void* data, std::size_t size) -> bool
+{
+    const auto* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const auto sent = ::send(fd_, bytes, size, SEND_FLAGS);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (peerGone(errno)) {
+                return false;
+            }
+            throw std::runtime_error(errorString("send"));
+        }
+        bytes += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+auto Socket::receive(void* data, std::size_t size) -> std::size_t
+{
+    for (;;) {
+        const auto received = ::recv(fd_, data, size, 0);
+        if (received >= 0) {
+            return static_cast<std::size_t>(received);
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (peerGone(errno)) {
+            return 0;
+        }
+        throw std::runtime_error(errorString("recv"));
+    }
+}
+
+auto Socket::receiveAll(void* data, std::size_t size) -> bool
+{
+    auto* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        const auto received = receive(bytes, size);
+        if (received == 0) {
+            return false;
+        }
+        bytes += received;
+        size -= received;
+    }
+    return true;
+}
+
+} // namespace glFractals
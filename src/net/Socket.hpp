@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace glFractals {
+
+// A blocking stream socket, owning its descriptor. Addresses are either
+// "unix:PATH" for a Unix domain socket or "HOST:PORT" for TCP. Errors throw
+// std::runtime_error, except the ones telling the peer went away.
+class Socket {
+public:
+    Socket() = default;
+    ~Socket();
+
+    Socket(Socket&& other);
+    Socket& operator=(Socket&& other);
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    // Binds and listens. Replaces stale Unix socket files.
+    static auto listen(const std::string& address) -> Socket;
+    static auto connect(const std::string& address) -> Socket;
+
+    // Waits for the next connection to a listening socket.
+    auto accept() -> Socket;
+
+    auto valid() const -> bool;
+    auto fd() const -> int;
+    void close();
+
+    // Sends all bytes, returns false when the peer closed the connection.
+    auto send(const void* data, std::size_t size) -> bool;
+    // Receives what arrived, at least one and at most size bytes. Returns 0
+    // when the peer closed the connection.
+    auto receive(void* data, std::size_t size) -> std::size_t;
+    // Receives exactly size bytes, returns false when the peer closed the
+    // connection first.
+    auto receiveAll(void* data, std::size_t size) -> bool;
+
+private:
+    explicit Socket(int fd);
+
+    int fd_ = -1;
+    // Removed again when a listening Unix socket closes.
+    std::string unixPath_;
+};
+
+} // namespace glFractals
@@ -0,0 +1,226 @@
+#include "TileCoordinator.hpp"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace glFractals {
+
+// Read from a connection at a time.
+static constexpr std::size_t RECEIVE_CHUNK = 1 << 16;
+
+struct TileCoordinator::Connection {
+    Connection(Socket s, std::uint64_t n)
+        : socket(std::move(s)), number(n)
+    {
+    }
+
+    Socket socket;
+    // Counts the workers of the coordinator, for the log.
+    std::uint64_t number;
+    MessageBuffer received;
+    bool greeted = false;
+    // The tile the worker renders, -1 for none.
+    long long tile = -1;
+};
+
+TileCoordinator::TileCoordinator(const std::string& address,
+                                 const TileJob& job,
+                                 int tileSize)
+    : listener_(Socket::listen(address)), jobMessage_(encodeJob(job))
+{
+    if (tileSize < 1 || tileSize > MAX_TILE_SIZE) {
+        throw std::runtime_error("tile size must be between 1 and " +
+                                 std::to_string(MAX_TILE_SIZE));
+    }
+
+    const auto& res = job.params.viewResolution;
+    for (int y0 = 0; y0 < res.y; y0 += tileSize) {
+        for (int x0 = 0; x0 < res.x; x0 += tileSize) {
+            auto tile = Tile();
+            tile.id = static_cast<std::uint32_t>(tiles_.size());
+            tile.rect = {x0,
+                         y0,
+                         std::min(x0 + tileSize, res.x) - 1,
+                         std::min(y0 + tileSize, res.y) - 1};
+            tiles_.push_back(tile);
+            unassigned_.push_back(tile.id);
+        }
+    }
+    done_.assign(tiles_.size(), false);
+    holders_.assign(tiles_.size(), 0);
+}
+
+TileCoordinator::~TileCoordinator() = default;
+
+void TileCoordinator::run(TileImage& image)
+{
+    std::vector<pollfd> fds;
+    while (completed_ < tiles_.size()) {
+        fds.clear();
+        fds.push_back({listener_.fd(), POLLIN, 0});
+        for (const auto& connection : connections_) {
+            fds.push_back({connection->socket.fd(), POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("poll failed");
+        }
+
+        // Connections accepted now weren't polled yet.
+        const auto polled = connections_.size();
+        if (fds[0].revents != 0) {
+            accept();
+        }
+        for (std::size_t i = 0; i < polled; i++) {
+            auto& connection = *connections_[i];
+            if (fds[i + 1].revents != 0 && !receive(connection, image)) {
+                drop(connection);
+            }
+        }
+        connections_.erase(
+            std::remove_if(
+                connections_.begin(),
+                connections_.end(),
+                [](const std::unique_ptr<Connection>& connection) {
+                    return !connection->socket.valid();
+                }),
+            connections_.end());
+    }
+
+    // Workers still rendering copies find out with their next message.
+    for (auto& connection : connections_) {
+        sendMessage(connection->socket, TileMessage::DONE, {});
+    }
+    connections_.clear();
+}
+
+auto TileCoordinator::tileCount() const -> std::size_t
+{
+    return tiles_.size();
+}
+
+auto TileCoordinator::stats() const -> const Stats& { return stats_; }
+
+void TileCoordinator::accept()
+{
+    stats_.workers++;
+    connections_.push_back(
+        std::make_unique<Connection>(listener_.accept(), stats_.workers));
+}
+
+auto TileCoordinator::receive(Connection& connection, TileImage& image)
+    -> bool
+{
+    unsigned char chunk[RECEIVE_CHUNK];
+    const auto size = connection.socket.receive(chunk, sizeof(chunk));
+    if (size == 0) {
+        return false;
+    }
+
+    // A misbehaving worker only loses its connection, the frame goes on.
+    try {
+        connection.received.append(chunk, size);
+        auto type = TileMessage::DONE;
+        std::vector<unsigned char> payload;
+        while (connection.received.next(type, payload)) {
+            if (!handle(connection, type, payload, image)) {
+                return false;
+            }
+        }
+    }
+    catch (const std::runtime_error& e) {
+        std::cerr << "worker " << connection.number << ": " << e.what()
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+auto TileCoordinator::handle(Connection& connection,
+                             TileMessage type,
+                             const std::vector<unsigned char>& payload,
+                             TileImage& image) -> bool
+{
+    if (type == TileMessage::HELLO && !connection.greeted) {
+        checkHello(payload);
+        connection.greeted = true;
+        std::cerr << "worker " << connection.number << " joined, "
+                  << connections_.size() << " connected" << std::endl;
+        return sendMessage(connection.socket, TileMessage::JOB, jobMessage_) &&
+               assign(connection);
+    }
+    if (type != TileMessage::RESULT || connection.tile < 0) {
+        throw std::runtime_error("unexpected message");
+    }
+
+    auto id = std::uint32_t();
+    std::vector<float> values;
+    decodeResult(payload, id, values);
+    const auto& rect = tiles_[connection.tile].rect;
+    const auto pixels = static_cast<std::size_t>(rect.x1 - rect.x0 + 1) *
+                        (rect.y1 - rect.y0 + 1);
+    if (id != connection.tile || values.size() != pixels) {
+        throw std::runtime_error("result for a different tile");
+    }
+
+    holders_[id]--;
+    connection.tile = -1;
+    if (!done_[id]) {
+        done_[id] = true;
+        completed_++;
+        image.write(rect, values);
+    }
+    return assign(connection);
+}
+
+auto TileCoordinator::assign(Connection& connection) -> bool
+{
+    auto next = -1LL;
+    if (!unassigned_.empty()) {
+        next = unassigned_.front();
+        unassigned_.pop_front();
+    }
+    else {
+        // Copies the outstanding tile fewest workers have.
+        for (std::size_t t = 0; t < tiles_.size(); t++) {
+            if (!done_[t] && (next < 0 || holders_[t] < holders_[next])) {
+                next = static_cast<long long>(t);
+            }
+        }
+        if (next < 0) {
+            // The frame is complete, run() sends DONE.
+            return true;
+        }
+        stats_.copies++;
+    }
+
+    holders_[next]++;
+    connection.tile = next;
+    return sendMessage(
+        connection.socket, TileMessage::TILE, encodeTile(tiles_[next]));
+}
+
+void TileCoordinator::drop(Connection& connection)
+{
+    const auto tile = connection.tile;
+    if (tile >= 0) {
+        holders_[tile]--;
+        if (!done_[tile] && holders_[tile] == 0) {
+            unassigned_.push_front(static_cast<std::uint32_t>(tile));
+            stats_.reassigned++;
+        }
+    }
+    connection.socket.close();
+    if (connection.greeted) {
+        std::cerr << "worker " << connection.number << " left" << std::endl;
+    }
+}
+
+} // namespace glFractals
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Socket.hpp"
+#include "TileImage.hpp"
+#include "TileProtocol.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// Splits a frame into tiles and hands them one at a time to the workers
+// connected to its socket, the next as soon as a worker sends the last one
+// back. Workers can join and leave at any time. The tile of a worker that
+// goes away is handed out again. Once every tile is out, idle workers get
+// copies of the tiles still outstanding, so a stalled worker can't hold the
+// frame up. Every worker renders a tile to the same values, so the first
+// result wins.
+class TileCoordinator {
+public:
+    struct Stats {
+        std::uint64_t workers = 0;
+        // Tiles handed out again after their worker went away.
+        std::uint64_t reassigned = 0;
+        // Tiles handed out while another worker still had them.
+        std::uint64_t copies = 0;
+    };
+
+    // Listens on address, see Socket. Throws std::runtime_error when it
+    // can't.
+    TileCoordinator(const std::string& address,
+                    const TileJob& job,
+                    int tileSize);
+    ~TileCoordinator();
+
+    // Serves workers until every tile came back, writing each one to image
+    // once.
+    void run(TileImage& image);
+
+    auto tileCount() const -> std::size_t;
+    auto stats() const -> const Stats&;
+
+private:
+    struct Connection;
+
+    Socket listener_;
+    std::vector<unsigned char> jobMessage_;
+    std::vector<Tile> tiles_;
+    std::vector<bool> done_;
+    // Workers currently rendering each tile.
+    std::vector<int> holders_;
+    // Tiles nobody has, handed out first.
+    std::deque<std::uint32_t> unassigned_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::size_t completed_ = 0;
+    Stats stats_ = {};
+
+    void accept();
+    // Returns false when the connection should be dropped.
+    auto receive(Connection& connection, TileImage& image) -> bool;
+    auto handle(Connection& connection,
+                TileMessage type,
+                const std::vector<unsigned char>& payload,
+                TileImage& image) -> bool;
+    auto assign(Connection& connection) -> bool;
+    void drop(Connection& connection);
+};
+
+} // namespace glFractals
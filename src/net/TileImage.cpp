@@ -0,0 +1,66 @@
+#include "TileImage.hpp"
+
+#include "Palette.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace glFractals {
+
+TileImage::TileImage(const std::string& path, Point2D<int> resolution)
+    : path_(path), resolution_(resolution),
+      file_(path,
+            std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc)
+{
+    if (!file_) {
+        throw std::runtime_error("failed to open " + path);
+    }
+
+    std::stringstream header;
+    header << "P6\n" << resolution.x << " " << resolution.y << "\n255\n";
+    file_ << header.str();
+    headerSize_ = static_cast<std::streamoff>(header.str().size());
+
+    // Writing the last byte sizes the file, the rest reads back as zeros
+    // until its tile arrives.
+    const auto pixels = std::streamoff(resolution.x) * resolution.y;
+    if (pixels > 0) {
+        file_.seekp(headerSize_ + 3 * pixels - 1);
+        file_.put(0);
+    }
+    if (!file_) {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
+
+void TileImage::write(const PixelRect& tile, const std::vector<float>& values)
+{
+    const auto width = tile.x1 - tile.x0 + 1;
+    row_.resize(3 * static_cast<std::size_t>(width));
+    for (int y = tile.y0; y <= tile.y1; y++) {
+        const auto* rowValues =
+            values.data() + static_cast<std::size_t>(y - tile.y0) * width;
+        for (int x = 0; x < width; x++) {
+            const auto color = paletteColor(rowValues[x]);
+            for (int c = 0; c < 3; c++) {
+                row_[3 * x + c] = static_cast<char>(color[c]);
+            }
+        }
+
+        // PPM rows go top down.
+        const auto fileRow = resolution_.y - 1 - y;
+        file_.seekp(headerSize_ +
+                    3 * (std::streamoff(fileRow) * resolution_.x + tile.x0));
+        file_.write(row_.data(), row_.size());
+    }
+}
+
+void TileImage::close()
+{
+    file_.close();
+    if (!file_) {
+        throw std::runtime_error("failed to write " + path_);
+    }
+}
+
+} // namespace glFractals
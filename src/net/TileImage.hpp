@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Common.hpp"
+#include "Symmetry.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace glFractals {
+
+// A binary PPM of a whole frame, written tile by tile in any order as the
+// tiles arrive, so frames far larger than memory can be rendered. Values are
+// colored with paletteColor.
+class TileImage {
+public:
+    // Creates the file at its full size. Throws std::runtime_error when it
+    // can't be written.
+    TileImage(const std::string& path, Point2D<int> resolution);
+
+    // Values hold the pixels of tile, rows bottom up.
+    void write(const PixelRect& tile, const std::vector<float>& values);
+    // Flushes the file, throwing std::runtime_error if any write failed.
+    void close();
+
+private:
+    std::string path_;
+    Point2D<int> resolution_;
+    std::fstream file_;
+    // Bytes before the first pixel.
+    std::streamoff headerSize_ = 0;
+    std::vector<char> row_;
+};
+
+} // namespace glFractals
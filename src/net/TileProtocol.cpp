@@ -0,0 +1,220 @@
+#include "TileProtocol.hpp"
+
+#include "Bytes.hpp"
+
+#include <iterator>
+#include <stdexcept>
+
+namespace glFractals {
+
+static constexpr char MAGIC[4] = {'G', 'F', 'T', 'L'};
+static constexpr std::uint32_t VERSION = 1;
+// Type byte and payload size.
+static constexpr std::size_t HEADER_SIZE = 5;
+// A result of the largest tile.
+static constexpr std::size_t MAX_PAYLOAD =
+    8 + 4 * std::size_t(MAX_TILE_SIZE) * MAX_TILE_SIZE;
+
+static const std::string PAYLOAD_NAME = "tile message";
+
+auto encodeHello() -> std::vector<unsigned char>
+{
+    std::vector<unsigned char> out(std::begin(MAGIC), std::end(MAGIC));
+    putU32(out, VERSION);
+    return out;
+}
+
+void checkHello(const std::vector<unsigned char>& payload)
+{
+    auto reader = ByteReader(payload, PAYLOAD_NAME);
+    for (const auto c : MAGIC) {
+        if (reader.byte() != static_cast<unsigned char>(c)) {
+            throw std::runtime_error("not a glFractals tile worker");
+        }
+    }
+    if (reader.u32() != VERSION) {
+        throw std::runtime_error("unknown tile protocol version");
+    }
+}
+
+auto encodeJob(const TileJob& job) -> std::vector<unsigned char>
+{
+    const auto& params = job.params;
+    std::vector<unsigned char> out;
+    out.push_back(static_cast<unsigned char>(params.type));
+    out.push_back(static_cast<unsigned char>(params.mode));
+    out.push_back(static_cast<unsigned char>(params.formula.power));
+    out.push_back(static_cast<unsigned char>(params.formula.fold));
+    out.push_back(static_cast<unsigned char>(job.arithmetic));
+    putU32(out, static_cast<std::uint32_t>(params.iterations));
+    putU32(out, static_cast<std::uint32_t>(params.viewResolution.x));
+    putU32(out, static_cast<std::uint32_t>(params.viewResolution.y));
+    putDouble(out, params.compCenter.x);
+    putDouble(out, params.compCenter.y);
+    putDouble(out, params.compResolution.x);
+    putDouble(out, params.compResolution.y);
+    putDouble(out, params.seed.x);
+    putDouble(out, params.seed.y);
+    return out;
+}
+
+auto decodeJob(const std::vector<unsigned char>& payload) -> TileJob
+{
+    auto reader = ByteReader(payload, PAYLOAD_NAME);
+    const auto type = reader.byte();
+    const auto mode = reader.byte();
+    const auto power = reader.byte();
+    const auto fold = reader.byte();
+    const auto arithmetic = reader.byte();
+    if (type > static_cast<unsigned char>(FractalType::JULIA) ||
+        mode > static_cast<unsigned char>(RenderMode::DISTANCE_ESTIMATE) ||
+        power < 2 || power > MAX_FORMULA_POWER ||
+        fold > static_cast<unsigned char>(Fold::CONJUGATE) ||
+        arithmetic >
+            static_cast<unsigned char>(CpuRenderer::Arithmetic::FIXED_POINT)) {
+        throw std::runtime_error("tile job with unknown settings");
+    }
+
+    auto job = TileJob();
+    auto& params = job.params;
+    params.type = static_cast<FractalType>(type);
+    params.mode = static_cast<RenderMode>(mode);
+    params.formula.power = power;
+    params.formula.fold = static_cast<Fold>(fold);
+    job.arithmetic = static_cast<CpuRenderer::Arithmetic>(arithmetic);
+    params.iterations = static_cast<int>(reader.u32());
+    params.viewResolution.x = static_cast<int>(reader.u32());
+    params.viewResolution.y = static_cast<int>(reader.u32());
+    params.compCenter.x = reader.f64();
+    params.compCenter.y = reader.f64();
+    params.compResolution.x = reader.f64();
+    params.compResolution.y = reader.f64();
+    params.seed.x = reader.f64();
+    params.seed.y = reader.f64();
+    if (params.iterations <= 0 || params.viewResolution.x <= 0 ||
+        params.viewResolution.y <= 0) {
+        throw std::runtime_error("tile job with an empty frame");
+    }
+    return job;
+}
+
+auto encodeTile(const Tile& tile) -> std::vector<unsigned char>
+{
+    std::vector<unsigned char> out;
+    putU32(out, tile.id);
+    putU32(out, static_cast<std::uint32_t>(tile.rect.x0));
+    putU32(out, static_cast<std::uint32_t>(tile.rect.y0));
+    putU32(out, static_cast<std::uint32_t>(tile.rect.x1));
+    putU32(out, static_cast<std::uint32_t>(tile.rect.y1));
+    return out;
+}
+
+auto decodeTile(const std::vector<unsigned char>& payload) -> Tile
+{
+    auto reader = ByteReader(payload, PAYLOAD_NAME);
+    auto tile = Tile();
+    tile.id = reader.u32();
+    tile.rect.x0 = static_cast<int>(reader.u32());
+    tile.rect.y0 = static_cast<int>(reader.u32());
+    tile.rect.x1 = static_cast<int>(reader.u32());
+    tile.rect.y1 = static_cast<int>(reader.u32());
+    if (tile.rect.x0 < 0 || tile.rect.y0 < 0 || tile.rect.x1 < tile.rect.x0 ||
+        tile.rect.y1 < tile.rect.y0 ||
+        tile.rect.x1 - tile.rect.x0 >= MAX_TILE_SIZE ||
+        tile.rect.y1 - tile.rect.y0 >= MAX_TILE_SIZE) {
+        throw std::runtime_error("tile with an invalid rectangle");
+    }
+    return tile;
+}
+
+auto encodeResult(std::uint32_t id, const std::vector<float>& values)
+    -> std::vector<unsigned char>
+{
+    std::vector<unsigned char> out;
+    out.reserve(4 + 4 * values.size());
+    putU32(out, id);
+    for (const auto v : values) {
+        putFloat(out, v);
+    }
+    return out;
+}
+
+void decodeResult(const std::vector<unsigned char>& payload,
+                  std::uint32_t& id,
+                  std::vector<float>& values)
+{
+    auto reader = ByteReader(payload, PAYLOAD_NAME);
+    id = reader.u32();
+    values.resize((payload.size() - 4) / 4);
+    for (auto& v : values) {
+        v = reader.f32();
+    }
+    if (!reader.done()) {
+        throw std::runtime_error("tile result with a partial value");
+    }
+}
+
+auto sendMessage(Socket& socket,
+                 TileMessage type,
+                 const std::vector<unsigned char>& payload) -> bool
+{
+    std::vector<unsigned char> message;
+    message.reserve(HEADER_SIZE + payload.size());
+    message.push_back(static_cast<unsigned char>(type));
+    putU32(message, static_cast<std::uint32_t>(payload.size()));
+    message.insert(message.end(), payload.begin(), payload.end());
+    return socket.send(message.data(), message.size());
+}
+
+static auto checkedSize(const unsigned char* header) -> std::size_t
+{
+    auto reader = ByteReader(header + 1, HEADER_SIZE - 1, PAYLOAD_NAME);
+    const auto size = reader.u32();
+    if (size > MAX_PAYLOAD) {
+        throw std::runtime_error("tile message too large");
+    }
+    return size;
+}
+
+auto receiveMessage(Socket& socket,
+                    TileMessage& type,
+                    std::vector<unsigned char>& payload) -> bool
+{
+    unsigned char header[HEADER_SIZE];
+    if (!socket.receiveAll(header, HEADER_SIZE)) {
+        return false;
+    }
+    type = static_cast<TileMessage>(header[0]);
+    payload.resize(checkedSize(header));
+    return payload.empty() || socket.receiveAll(payload.data(), payload.size());
+}
+
+void MessageBuffer::append(const unsigned char* data, std::size_t size)
+{
+    // Drops the handed out messages before growing.
+    if (consumed_ > 0) {
+        data_.erase(data_.begin(), data_.begin() + consumed_);
+        consumed_ = 0;
+    }
+    data_.insert(data_.end(), data, data + size);
+}
+
+auto MessageBuffer::next(TileMessage& type, std::vector<unsigned char>& payload)
+    -> bool
+{
+    const auto available = data_.size() - consumed_;
+    if (available < HEADER_SIZE) {
+        return false;
+    }
+    const auto* header = data_.data() + consumed_;
+    const auto size = checkedSize(header);
+    if (available < HEADER_SIZE + size) {
+        return false;
+    }
+    type = static_cast<TileMessage>(header[0]);
+    payload.assign(header + HEADER_SIZE, header + HEADER_SIZE + size);
+    consumed_ += HEADER_SIZE + size;
+    return true;
+}
+
+} // namespace glFractals
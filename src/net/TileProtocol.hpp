@@ -0,0 +1,80 @@
+#pragma once
+
+#include "CpuRenderer.hpp"
+#include "FractalParams.hpp"
+#include "Socket.hpp"
+#include "Symmetry.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace glFractals {
+
+// The messages between a tile coordinator and its workers. Each is a type
+// byte and the payload size as a little endian u32, then the payload.
+// Workers open with HELLO and get the JOB, then a TILE. Every RESULT they
+// send back is answered with the next TILE, or DONE once the frame is
+// complete.
+enum class TileMessage : unsigned char {
+    // The magic "GFTL" and the protocol version.
+    HELLO = 1,
+    // The frame every tile belongs to, see TileJob.
+    JOB,
+    // A tile id and its pixel rectangle.
+    TILE,
+    // A tile id and the values of its pixels, rows bottom up.
+    RESULT,
+    DONE
+};
+
+// Tiles are at most this many pixels wide and high, which bounds the size of
+// the messages.
+static constexpr int MAX_TILE_SIZE = 1024;
+
+// What a worker needs to render any tile of a frame.
+struct TileJob {
+    FractalParams params = {};
+    CpuRenderer::Arithmetic arithmetic = CpuRenderer::Arithmetic::DOUBLE;
+};
+
+struct Tile {
+    std::uint32_t id = 0;
+    PixelRect rect = {};
+};
+
+// The decoders throw std::runtime_error on malformed payloads.
+auto encodeHello() -> std::vector<unsigned char>;
+void checkHello(const std::vector<unsigned char>& payload);
+auto encodeJob(const TileJob& job) -> std::vector<unsigned char>;
+auto decodeJob(const std::vector<unsigned char>& payload) -> TileJob;
+auto encodeTile(const Tile& tile) -> std::vector<unsigned char>;
+auto decodeTile(const std::vector<unsigned char>& payload) -> Tile;
+auto encodeResult(std::uint32_t id, const std::vector<float>& values)
+    -> std::vector<unsigned char>;
+void decodeResult(const std::vector<unsigned char>& payload,
+                  std::uint32_t& id,
+                  std::vector<float>& values);
+
+// Return false when the peer closed the connection.
+auto sendMessage(Socket& socket,
+                 TileMessage type,
+                 const std::vector<unsigned char>& payload) -> bool;
+auto receiveMessage(Socket& socket,
+                    TileMessage& type,
+                    std::vector<unsigned char>& payload) -> bool;
+
+// Splits the bytes of a connection read piecewise into messages.
+class MessageBuffer {
+public:
+    void append(const unsigned char* data, std::size_t size);
+    // Moves the next complete message out. Throws std::runtime_error when
+    // the message claims to be larger than any valid one.
+    auto next(TileMessage& type, std::vector<unsigned char>& payload) -> bool;
+
+private:
+    std::vector<unsigned char> data_;
+    // Bytes of data_ already handed out.
+    std::size_t consumed_ = 0;
+};
+
+} // namespace glFractals
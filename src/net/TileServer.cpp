@@ -0,0 +1,465 @@
+#include "TileServer.hpp"
+
+#include "Palette.hpp"
+#include "Parallel.hpp"
+#include "Png.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <utility>
+
+namespace glFractals {
+
+constexpr int TileServer::TILE_SIZE;
+constexpr int TileServer::MAX_ZOOM;
+constexpr int TileServer::ITERATIONS_PER_ZOOM;
+constexpr std::size_t TileServer::LATENCY_SAMPLES;
+
+// Requests with longer headers are dropped.
+static constexpr std::size_t MAX_REQUEST_SIZE = 16 << 10;
+// Older prefetches are dropped beyond this, so panning quickly doesn't
+// leave a backlog of tiles nobody looks at anymore.
+static constexpr std::size_t MAX_PREFETCH = 64;
+
+struct TileServer::CacheEntry {
+    enum class State { QUEUED, RENDERING, RENDERED };
+
+    State state = State::QUEUED;
+    // Whether a request asked for the tile, and whether it was queued by
+    // prefetching before.
+    bool requested = false;
+    bool prefetched = false;
+    std::vector<unsigned char> png;
+    // Only valid once rendered.
+    std::list<TileKey>::iterator lru;
+};
+
+bool operator<(const TileServer::TileKey& l, const TileServer::TileKey& r)
+{
+    if (l.fractal != r.fractal) {
+        return l.fractal < r.fractal;
+    }
+    if (l.z != r.z) {
+        return l.z < r.z;
+    }
+    if (l.x != r.x) {
+        return l.x < r.x;
+    }
+    return l.y < r.y;
+}
+
+TileServer::TileServer(const std::string& address, const Settings& settings)
+    : listener_(Socket::listen(address)), settings_(settings),
+      fractalNames_(formulaNames()), start_(std::chrono::steady_clock::now())
+{
+    fractalNames_.push_back("julia");
+    for (unsigned t = 0; t < threadCount(settings_.threads); t++) {
+        renderThreads_.emplace_back(&TileServer::renderLoop, this);
+    }
+}
+
+TileServer::~TileServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workQueued_.notify_all();
+    for (auto& thread : renderThreads_) {
+        thread.join();
+    }
+}
+
+void TileServer::run()
+{
+    // Connections get a thread each, which mostly waits for the network or
+    // for tiles.
+    for (;;) {
+        std::thread(&TileServer::serve, this, listener_.accept()).detach();
+    }
+}
+
+void TileServer::renderLoop()
+{
+    // The render threads share the cores, each renders one tile at a time.
+    CpuRenderer renderer(1);
+    renderer.setSymmetry(false);
+    renderer.setArithmetic(settings_.arithmetic);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        workQueued_.wait(lock, [&]() {
+            return stopping_ || !requested_.empty() || !prefetch_.empty();
+        });
+        if (stopping_) {
+            return;
+        }
+        auto& queue = requested_.empty() ? prefetch_ : requested_;
+        const auto key = queue.front();
+        queue.pop_front();
+        // Promoted prefetches are queued twice.
+        const auto it = cache_.find(key);
+        if (it == cache_.end() ||
+            it->second->state != CacheEntry::State::QUEUED) {
+            continue;
+        }
+        const auto entry = it->second;
+        entry->state = CacheEntry::State::RENDERING;
+
+        lock.unlock();
+        const auto start = std::chrono::steady_clock::now();
+        auto png = renderTile(key, renderer);
+        const auto seconds = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        lock.lock();
+
+        (entry->requested ? counters_.rendered : counters_.prefetched)++;
+        counters_.renderSeconds += seconds;
+        entry->png = std::move(png);
+        entry->state = CacheEntry::State::RENDERED;
+        cachedBytes_ += entry->png.size();
+        entry->lru = lru_.insert(lru_.end(), key);
+        evict();
+        tileRendered_.notify_all();
+    }
+}
+
+auto TileServer::renderTile(const TileKey& key, CpuRenderer& renderer)
+    -> std::vector<unsigned char>
+{
+    auto params = FractalParams();
+    const auto julia = key.fractal == int(fractalNames_.size()) - 1;
+    if (julia) {
+        params.type = FractalType::JULIA;
+        params.formula = settings_.juliaFormula;
+        params.seed = settings_.juliaSeed;
+    }
+    else {
+        params.formula = formulaByName(fractalNames_[key.fractal]);
+    }
+    params.iterations = settings_.iterations + ITERATIONS_PER_ZOOM * key.z;
+    params.viewResolution = {TILE_SIZE, TILE_SIZE};
+    const auto side = 4.0 / double(1LL << key.z);
+    params.compResolution = {side, side};
+    params.compCenter = {-2.0 + (key.x + 0.5) * side,
+                         2.0 - (key.y + 0.5) * side};
+
+    std::vector<float> values;
+    renderer.render(params, values);
+
+    // Values go bottom up, PNG rows top down.
+    std::vector<unsigned char> rgb;
+    rgb.reserve(3 * values.size());
+    for (int y = TILE_SIZE - 1; y >= 0; y--) {
+        for (int x = 0; x < TILE_SIZE; x++) {
+            const auto color = paletteColor(values[y * TILE_SIZE + x]);
+            rgb.insert(rgb.end(), color.begin(), color.end());
+        }
+    }
+    return encodePng(TILE_SIZE, TILE_SIZE, rgb);
+}
+
+auto TileServer::tile(const TileKey& key)
+    -> std::shared_ptr<const CacheEntry>
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    counters_.tileRequests++;
+
+    auto& slot = cache_[key];
+    if (!slot) {
+        slot = std::make_shared<CacheEntry>();
+    }
+    // Eviction may drop the slot while we wait.
+    const auto entry = slot;
+    if (entry->state == CacheEntry::State::RENDERED) {
+        counters_.cacheHits++;
+    }
+    if (!entry->requested) {
+        if (entry->prefetched) {
+            counters_.prefetchHits++;
+        }
+        entry->requested = true;
+        if (entry->state == CacheEntry::State::QUEUED) {
+            requested_.push_back(key);
+            workQueued_.notify_one();
+        }
+    }
+    else if (entry->state != CacheEntry::State::RENDERED) {
+        counters_.coalesced++;
+    }
+
+    tileRendered_.wait(lock, [&]() {
+        return entry->state == CacheEntry::State::RENDERED;
+    });
+    const auto it = cache_.find(key);
+    if (it != cache_.end() && it->second == entry) {
+        lru_.splice(lru_.end(), lru_, entry->lru);
+    }
+    prefetchAround(key);
+    return entry;
+}
+
+void TileServer::prefetchAround(const TileKey& key)
+{
+    const auto tiles = 1LL << key.z;
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            auto neighbour = key;
+            neighbour.x += dx;
+            neighbour.y += dy;
+            if (neighbour.x < 0 || neighbour.x >= tiles || neighbour.y < 0 ||
+                neighbour.y >= tiles || cache_.count(neighbour) != 0) {
+                continue;
+            }
+            auto entry = std::make_shared<CacheEntry>();
+            entry->prefetched = true;
+            cache_[neighbour] = entry;
+            prefetch_.push_back(neighbour);
+            workQueued_.notify_one();
+        }
+    }
+
+    while (prefetch_.size() > MAX_PREFETCH) {
+        const auto it = cache_.find(prefetch_.front());
+        prefetch_.pop_front();
+        if (it != cache_.end() && !it->second->requested &&
+            it->second->state == CacheEntry::State::QUEUED) {
+            cache_.erase(it);
+            counters_.prefetchDropped++;
+        }
+    }
+}
+
+void TileServer::evict()
+{
+    // Keeps the tile just rendered, however large.
+    while (cachedBytes_ > settings_.cacheBytes && lru_.size() > 1) {
+        const auto it = cache_.find(lru_.front());
+        cachedBytes_ -= it->second->png.size();
+        cache_.erase(it);
+        lru_.pop_front();
+    }
+}
+
+// Parses a decimal number without sign, false on anything else.
+static auto parseNumber(const std::string& s, long long& value) -> bool
+{
+    if (s.empty() || s.size() > 18) {
+        return false;
+    }
+    value = 0;
+    for (const auto c : s) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+static auto statusText(int status) -> const char*
+{
+    switch (status) {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    default:
+        return "Method Not Allowed";
+    }
+}
+
+static auto bytes(const std::string& s) -> std::vector<unsigned char>
+{
+    return std::vector<unsigned char>(s.begin(), s.end());
+}
+
+void TileServer::serve(Socket socket)
+{
+    std::string buffer;
+    for (;;) {
+        auto end = buffer.find("\r\n\r\n");
+        while (end == std::string::npos) {
+            if (buffer.size() > MAX_REQUEST_SIZE) {
+                return;
+            }
+            char chunk[4096];
+            const auto size = socket.receive(chunk, sizeof(chunk));
+            if (size == 0) {
+                return;
+            }
+            buffer.append(chunk, size);
+            end = buffer.find("\r\n\r\n");
+        }
+        auto request = buffer.substr(0, end);
+        buffer.erase(0, end + 4);
+
+        std::istringstream requestLine(request.substr(0, request.find('\r')));
+        std::string method;
+        std::string target;
+        std::string version;
+        requestLine >> method >> target >> version;
+        std::transform(
+            request.begin(), request.end(), request.begin(), [](char c) {
+                return static_cast<char>(
+                    std::tolower(static_cast<unsigned char>(c)));
+            });
+        const auto keepAlive =
+            version == "HTTP/1.1" &&
+            request.find("\r\nconnection: close") == std::string::npos;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            counters_.requests++;
+        }
+
+        auto contentType = std::string("text/plain");
+        std::vector<unsigned char> body;
+        auto status = 405;
+        if (method == "GET" || method == "HEAD") {
+            status = respond(
+                target.substr(0, target.find('?')), contentType, body);
+        }
+        if (status != 200) {
+            contentType = "text/plain";
+            body = bytes(std::string(statusText(status)) + "\n");
+        }
+
+        std::ostringstream header;
+        header << "HTTP/1.1 " << status << " " << statusText(status)
+               << "\r\nContent-Type: " << contentType
+               << "\r\nContent-Length: " << body.size()
+               << "\r\nConnection: " << (keepAlive ? "keep-alive" : "close")
+               << "\r\n\r\n";
+        const auto head = header.str();
+        if (!socket.send(head.data(), head.size()) ||
+            (method != "HEAD" && !socket.send(body.data(), body.size())) ||
+            !keepAlive) {
+            return;
+        }
+    }
+}
+
+auto TileServer::respond(const std::string& path,
+                         std::string& contentType,
+                         std::vector<unsigned char>& body) -> int
+{
+    if (path == "/stats") {
+        contentType = "application/json";
+        body = bytes(statsJson());
+        return 200;
+    }
+    if (path == "/") {
+        std::ostringstream index;
+        index << "Tiles: /{fractal}/{z}/{x}/{y}.png, z up to " << MAX_ZOOM
+              << "\nFractals:";
+        for (const auto& name : fractalNames_) {
+            index << " " << name;
+        }
+        index << "\nCounters: /stats\n";
+        body = bytes(index.str());
+        return 200;
+    }
+
+    // /{fractal}/{z}/{x}/{y}.png
+    std::vector<std::string> parts;
+    std::istringstream segments(path.substr(1));
+    for (std::string part; std::getline(segments, part, '/');) {
+        parts.push_back(part);
+    }
+    const auto suffix = std::string(".png");
+    if (parts.size() != 4 || parts[3].size() <= suffix.size() ||
+        parts[3].compare(parts[3].size() - suffix.size(),
+                         suffix.size(),
+                         suffix) != 0) {
+        return 404;
+    }
+    parts[3].resize(parts[3].size() - suffix.size());
+
+    const auto fractal =
+        std::find(fractalNames_.begin(), fractalNames_.end(), parts[0]);
+    long long z = 0;
+    auto key = TileKey();
+    if (fractal == fractalNames_.end() || !parseNumber(parts[1], z) ||
+        !parseNumber(parts[2], key.x) || !parseNumber(parts[3], key.y) ||
+        z > MAX_ZOOM || key.x >= (1LL << z) || key.y >= (1LL << z)) {
+        return 404;
+    }
+    key.fractal = static_cast<int>(fractal - fractalNames_.begin());
+    key.z = static_cast<int>(z);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto entry = tile(key);
+    const auto seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (latencies_.size() < LATENCY_SAMPLES) {
+            latencies_.push_back(seconds);
+        }
+        else {
+            latencies_[nextLatency_] = seconds;
+        }
+        nextLatency_ = (nextLatency_ + 1) % LATENCY_SAMPLES;
+    }
+
+    contentType = "image/png";
+    body = entry->png;
+    return 200;
+}
+
+auto TileServer::statsJson() -> std::string
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto uptime = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start_)
+                            .count();
+    const auto renders = counters_.rendered + counters_.prefetched;
+
+    auto sorted = latencies_;
+    std::sort(sorted.begin(), sorted.end());
+    const auto percentile = [&](double p) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        const auto i = static_cast<std::size_t>(p * (sorted.size() - 1));
+        return sorted[i] * 1e3;
+    };
+    auto mean = 0.0;
+    for (const auto l : sorted) {
+        mean += l * 1e3 / sorted.size();
+    }
+
+    std::ostringstream out;
+    out << "{\n"
+        << "  \"uptime_seconds\": " << uptime << ",\n"
+        << "  \"requests\": " << counters_.requests << ",\n"
+        << "  \"tile_requests\": " << counters_.tileRequests << ",\n"
+        << "  \"tile_requests_per_second\": " << counters_.tileRequests / uptime
+        << ",\n"
+        << "  \"cache_hits\": " << counters_.cacheHits << ",\n"
+        << "  \"coalesced\": " << counters_.coalesced << ",\n"
+        << "  \"prefetch_hits\": " << counters_.prefetchHits << ",\n"
+        << "  \"rendered\": " << counters_.rendered << ",\n"
+        << "  \"prefetched\": " << counters_.prefetched << ",\n"
+        << "  \"prefetch_dropped\": " << counters_.prefetchDropped << ",\n"
+        << "  \"render_ms_per_tile\": "
+        << (renders > 0 ? counters_.renderSeconds * 1e3 / renders : 0.0)
+        << ",\n"
+        << "  \"queued\": " << requested_.size() + prefetch_.size() << ",\n"
+        << "  \"cached_tiles\": " << lru_.size() << ",\n"
+        << "  \"cached_bytes\": " << cachedBytes_ << ",\n"
+        << "  \"latency_ms\": {\"samples\": " << sorted.size()
+        << ", \"mean\": " << mean << ", \"p50\": " << percentile(0.5)
+        << ", \"p95\": " << percentile(0.95)
+        << ", \"p99\": " << percentile(0.99)
+        << ", \"max\": " << percentile(1.0) << "}\n"
+        << "}\n";
+    return out.str();
+}
+
+} // namespace glFractals
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Common.hpp"
+#include "CpuRenderer.hpp"
+#include "Formula.hpp"
+#include "Socket.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace glFractals {
+
+// Serves fractal tiles over HTTP for web map viewers, which request
+// /{fractal}/{z}/{x}/{y}.png in the usual slippy map scheme: zoom 0 is one
+// tile covering the square of side 4 around the origin, every zoom level
+// splits each tile in four, and y counts down from the top. Fractal is a
+// formula name for its Mandelbrot type set, or julia. /stats returns the
+// counters as JSON.
+//
+// Tiles are rendered on the CPU and kept in a byte bounded LRU cache.
+// Requests for a tile that is already being rendered wait for that render
+// instead of starting another. After every requested tile the neighbours at
+// its zoom are rendered in the background, behind any requested ones, so
+// panning mostly hits the cache.
+class TileServer {
+public:
+    struct Settings {
+        unsigned threads = 0;
+        // At zoom 0, every zoom level adds ITERATIONS_PER_ZOOM.
+        int iterations = 200;
+        Formula juliaFormula = {};
+        Point2D<double> juliaSeed = {-0.8, 0.156};
+        CpuRenderer::Arithmetic arithmetic = CpuRenderer::Arithmetic::DOUBLE;
+        std::size_t cacheBytes = std::size_t(256) << 20;
+    };
+
+    static constexpr int TILE_SIZE = 256;
+    // Beyond this doubles can't tell the pixels apart.
+    static constexpr int MAX_ZOOM = 40;
+    static constexpr int ITERATIONS_PER_ZOOM = 50;
+
+    // Listens on address, see Socket, and starts the render threads.
+    TileServer(const std::string& address, const Settings& settings);
+    ~TileServer();
+
+    // Answers requests until the process ends.
+    void run();
+
+private:
+    struct TileKey {
+        int fractal;
+        int z;
+        long long x;
+        long long y;
+    };
+    friend bool operator<(const TileKey& l, const TileKey& r);
+
+    struct CacheEntry;
+
+    Socket listener_;
+    Settings settings_;
+    // The fractals of the URLs, formula names then julia.
+    std::vector<std::string> fractalNames_;
+
+    // Guards everything below.
+    std::mutex mutex_;
+    // Signalled whenever a tile was rendered or work was queued.
+    std::condition_variable tileRendered_;
+    std::condition_variable workQueued_;
+    bool stopping_ = false;
+    std::map<TileKey, std::shared_ptr<CacheEntry>> cache_;
+    // Rendered entries, least recently used first.
+    std::list<TileKey> lru_;
+    std::size_t cachedBytes_ = 0;
+    // Requested tiles go before prefetched ones.
+    std::deque<TileKey> requested_;
+    std::deque<TileKey> prefetch_;
+
+    struct Counters {
+        std::uint64_t requests = 0;
+        std::uint64_t tileRequests = 0;
+        std::uint64_t cacheHits = 0;
+        // Requests that waited for a render another one started.
+        std::uint64_t coalesced = 0;
+        // Requests answered by a tile the background rendered first.
+        std::uint64_t prefetchHits = 0;
+        std::uint64_t rendered = 0;
+        std::uint64_t prefetched = 0;
+        std::uint64_t prefetchDropped = 0;
+        double renderSeconds = 0.0;
+    };
+    Counters counters_ = {};
+    // The latencies of the last LATENCY_SAMPLES tile requests.
+    static constexpr std::size_t LATENCY_SAMPLES = 1024;
+    std::vector<double> latencies_;
+    std::size_t nextLatency_ = 0;
+    std::chrono::steady_clock::time_point start_;
+
+    std::vector<std::thread> renderThreads_;
+
+    void renderLoop();
+    auto renderTile(const TileKey& key, CpuRenderer& renderer)
+        -> std::vector<unsigned char>;
+    // Returns the PNG of the tile, rendering it first unless it is cached or
+    // being rendered. Counts the request.
+    auto tile(const TileKey& key) -> std::shared_ptr<const CacheEntry>;
+    // Queues the neighbours that aren't cached yet. Needs the lock.
+    void prefetchAround(const TileKey& key);
+    // Drops least recently used tiles over the budget. Needs the lock.
+    void evict();
+
+    void serve(Socket socket);
+    // Returns the status, content type and body of a GET of path.
+    auto respond(const std::string& path,
+                 std::string& contentType,
+                 std::vector<unsigned char>& body) -> int;
+    auto statsJson() -> std::string;
+};
+
+} // namespace glFractals
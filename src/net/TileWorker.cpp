@@ -0,0 +1,69 @@
+#include "TileWorker.hpp"
+
+#include "CpuRenderer.hpp"
+#include "Socket.hpp"
+#include "TileProtocol.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace glFractals {
+
+// How long workers wait for their coordinator to start listening.
+static constexpr auto CONNECT_TIMEOUT = std::chrono::seconds(10);
+static constexpr auto CONNECT_RETRY = std::chrono::milliseconds(100);
+
+static auto connectWithRetry(const std::string& address) -> Socket
+{
+    const auto deadline = std::chrono::steady_clock::now() + CONNECT_TIMEOUT;
+    for (;;) {
+        try {
+            return Socket::connect(address);
+        }
+        catch (const std::runtime_error&) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                throw;
+            }
+        }
+        std::this_thread::sleep_for(CONNECT_RETRY);
+    }
+}
+
+auto runTileWorker(const std::string& address, unsigned threads)
+    -> std::uint64_t
+{
+    auto socket = connectWithRetry(address);
+    auto type = TileMessage::DONE;
+    std::vector<unsigned char> payload;
+    if (!sendMessage(socket, TileMessage::HELLO, encodeHello()) ||
+        !receiveMessage(socket, type, payload)) {
+        throw std::runtime_error("the coordinator closed the connection");
+    }
+    if (type != TileMessage::JOB) {
+        throw std::runtime_error("expected a tile job");
+    }
+    const auto job = decodeJob(payload);
+
+    CpuRenderer renderer(threads);
+    renderer.setArithmetic(job.arithmetic);
+
+    std::uint64_t rendered = 0;
+    std::vector<float> values;
+    // A closed connection ends the job too, the coordinator doesn't wait for
+    // copies of tiles it already has.
+    while (receiveMessage(socket, type, payload) &&
+           type == TileMessage::TILE) {
+        const auto tile = decodeTile(payload);
+        renderer.renderTile(job.params, tile.rect, values);
+        rendered++;
+        if (!sendMessage(
+                socket, TileMessage::RESULT, encodeResult(tile.id, values))) {
+            break;
+        }
+    }
+    return rendered;
+}
+
+} // namespace glFractals
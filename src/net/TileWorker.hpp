@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace glFractals {
+
+// Renders tiles on the CPU for the coordinator at address, see
+// TileCoordinator, until it has none left or goes away. Keeps trying to
+// connect for a while, so workers can start before their coordinator.
+// Returns the number of tiles rendered. Throws std::runtime_error when no
+// coordinator answers or it speaks another protocol.
+auto runTileWorker(const std::string& address, unsigned threads)
+    -> std::uint64_t;
+
+} // namespace glFractals
@@ -0,0 +1,12 @@
+#version 330
+
+// Maps a distance estimate to the unit interval the palette colors. Brightest
+// right at the boundary, fading out over a few pixels. Keep in sync with
+// distanceValue in Kernels.hpp.
+float distanceValue(float distance, float pixelSize)
+{
+    // The derivative overflows on long orbits next to the set.
+    if (isnan(distance) || isinf(distance))
+        distance = 0.0;
+    return 0.3 / (1.0 + 0.25 * distance / pixelSize);
+}
@@ -0,0 +1,8 @@
+#version 330
+
+out float value;
+
+// Provided by the fractal shader (Mandelbrot.fs or Julia.fs).
+float fractalValue(vec2 fragCoord);
+
+void main() { value = fractalValue(gl_FragCoord.xy); }
@@ -1,60 +1,92 @@
 #version 330
 
-uniform int iterations = 100;
+// Per frame parameters, written with a single buffer update by
+// FractalRenderer. Every shader declaring the block has to declare it the same
+// way. Keep in sync with FrameUniforms in FractalRenderer.cpp.
+layout(std140) uniform FrameParams
+{
+    int iterations;
+    // Iterate the derivative too and return distanceValue instead.
+    bool distanceEstimation;
 
-uniform float viewWidth;
-uniform float viewHeight;
+    float viewWidth;
+    float viewHeight;
 
-uniform float compWidth;
-uniform float compHeight;
+    float compWidth;
+    float compHeight;
 
-uniform float compCenterX;
-uniform float compCenterY;
+    float compCenterX;
+    float compCenterY;
 
-out vec4 fragColor;
+    // Only used by Julia.fs.
+    float seedX;
+    float seedY;
 
-// Assumes unit interval, based on cubic hermite splines.
-// p0 = point at t = 0
-// p1 = point at t = 1
-// m0 = slope at t = 0
-// m1 = slope at t = 1
-float cubicInterp(float i, float p0, float p1, float m0, float m1)
-{
-    return (pow(i, 3) * (2 * p0 + m0 - 2 * p1 + m1)) +
-           (i * i * (-3 * p0 - 2 * m0 + 3 * p1 - m1)) + (i * m0) + p0;
-}
+    // Symmetry::Type of the frame, 0 = none, 1 = real axis, 2 = point.
+    int symmetry;
+    // The mirror image of pixel p is mirrorOffset - p, see Symmetry.hpp.
+    int mirrorOffsetX;
+    int mirrorOffsetY;
+};
+
+// Keep in sync with Kernels.hpp.
+const float ESCAPE_RADIUS_SQ = 4.0;
+const float DE_ESCAPE_RADIUS_SQ = 1.0e4;
+
+float distanceValue(float distance, float pixelSize);
+
+// Generated from the formula, see FormulaShader.cpp.
+vec2 formulaStep(vec2 z, vec2 c);
+vec2 formulaDerivative(vec2 z, vec2 dz, vec2 dc);
 
 // The Mandelbrot set is the set of complex numbers c where
 // fn(z) = fn-1(z)^2 + c does not diverge, f0(z) = c (i.e, iterate with z = 0).
+// Other formulas replace the square by formulaStep.
 // Using 2d image coordinates for c makes cool fractals.
-void main()
+// Returns the escape iteration of the point at fragCoord over iterations, or
+// its distanceValue when distanceEstimation is set.
+float fractalValue(vec2 fragCoord)
 {
-    float x = (gl_FragCoord.x - viewWidth / 2) / viewWidth * compWidth;
-    float y = (gl_FragCoord.y - viewHeight / 2) / viewHeight * compHeight;
+    float x = (fragCoord.x - viewWidth / 2) / viewWidth * compWidth;
+    float y = (fragCoord.y - viewHeight / 2) / viewHeight * compHeight;
     vec2 c = vec2(x, y) + vec2(compCenterX, compCenterY);
 
+    float radiusSq =
+        distanceEstimation ? DE_ESCAPE_RADIUS_SQ : ESCAPE_RADIUS_SQ;
+
     // fi we will iterate with. Since initial z = 0, f0(z) = c;
     vec2 fi = c;
+    // dfi is the derivative of fi with respect to c, dfi' = 2 * fi * dfi + 1
+    // for the square.
+    vec2 dfi = vec2(1.0, 0.0);
+    float magSq;
     int i;
     for (i = 1; i < iterations; i++) {
         // First test this iteration.
-        float x = fi.x * fi.x - fi.y * fi.y + c.x;
-        float y = 2 * fi.x * fi.y + c.y;
+        vec2 next = formulaStep(fi, c);
+
+        if (distanceEstimation) {
+            dfi = formulaDerivative(fi, dfi, vec2(1.0, 0.0));
+        }
 
         // Apparently if the magnitude ever goes above 2 (or mag squard above
         // 4), then it will for sure be not in the set.
-        if ((x * x + y * y) > 4.0)
+        magSq = dot(next, next);
+        if (magSq > radiusSq)
             break;
 
-        fi.x = x;
-        fi.y = y;
+        fi = next;
     }
 
-    float slider = float(i) / float(iterations);
+    if (distanceEstimation) {
+        if (i >= iterations)
+            return 1.0;
+        // Koebe 1/4 theorem: the real distance is between a quarter and the
+        // full 2|z|log|z|/|dz|.
+        float mag = sqrt(magSq);
+        return distanceValue(0.5 * mag * log(mag) / length(dfi),
+                             compHeight / viewHeight);
+    }
 
-    // Purely based on experimentation.
-    fragColor = vec4(cubicInterp(slider, 0, 0, 1, -6),
-                     cubicInterp(slider, 0, 0, 4, -3),
-                     cubicInterp(slider, 0.1, 0, 6, 0),
-                     1.0);
+    return float(i) / float(iterations);
 }
@@ -0,0 +1,22 @@
+#version 330
+
+// Assumes unit interval, based on cubic hermite splines.
+// p0 = point at t = 0
+// p1 = point at t = 1
+// m0 = slope at t = 0
+// m1 = slope at t = 1
+float cubicInterp(float i, float p0, float p1, float m0, float m1)
+{
+    return (pow(i, 3) * (2 * p0 + m0 - 2 * p1 + m1)) +
+           (i * i * (-3 * p0 - 2 * m0 + 3 * p1 - m1)) + (i * m0) + p0;
+}
+
+// Maps an iteration value in the unit interval to a color.
+vec4 palette(float slider)
+{
+    // Purely based on experimentation.
+    return vec4(cubicInterp(slider, 0, 0, 1, -6),
+                cubicInterp(slider, 0, 0, 4, -3),
+                cubicInterp(slider, 0.1, 0, 6, 0),
+                1.0);
+}
@@ -0,0 +1,71 @@
+#version 330
+
+// Per frame parameters, see Mandelbrot.fs.
+layout(std140) uniform FrameParams
+{
+    int iterations;
+    bool distanceEstimation;
+    float viewWidth;
+    float viewHeight;
+    float compWidth;
+    float compHeight;
+    float compCenterX;
+    float compCenterY;
+    float seedX;
+    float seedY;
+    int symmetry;
+    int mirrorOffsetX;
+    int mirrorOffsetY;
+};
+
+// Iteration values written by Iterations.fs.
+uniform sampler2D values;
+
+// Jittered samples added on top of the pixel center.
+uniform int subsamples = 8;
+// A pixel is refined when its 3x3 neighbourhood spans more iterations.
+uniform float threshold = 3.0;
+
+out vec4 fragColor;
+
+float fractalValue(vec2 fragCoord);
+vec4 palette(float slider);
+ivec2 valueTexel(ivec2 p, ivec2 size);
+
+float hash(vec2 p)
+{
+    return fract(sin(dot(p, vec2(12.9898, 78.233))) * 43758.5453);
+}
+
+// Only pixels whose neighbours disagree pass, everything else keeps the
+// single sample color from Resolve.fs.
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(values, 0);
+
+    float center = texelFetch(values, valueTexel(p, size), 0).r;
+    float lo = center;
+    float hi = center;
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            ivec2 q = clamp(p + ivec2(dx, dy), ivec2(0), size - 1);
+            float v = texelFetch(values, valueTexel(q, size), 0).r;
+            lo = min(lo, v);
+            hi = max(hi, v);
+        }
+    }
+    if ((hi - lo) * iterations <= threshold)
+        discard;
+
+    // R2 low discrepancy sequence, randomly rotated per pixel so neighbouring
+    // pixels don't alias with the same pattern.
+    vec2 offset = vec2(hash(gl_FragCoord.xy), hash(gl_FragCoord.yx + 17.0));
+    vec4 sum = palette(center);
+    for (int k = 1; k <= subsamples; k++) {
+        vec2 jitter =
+            fract(offset + float(k) * vec2(0.7548776662, 0.5698402910)) - 0.5;
+        sum += palette(fractalValue(gl_FragCoord.xy + jitter));
+    }
+    fragColor = sum / float(subsamples + 1);
+}
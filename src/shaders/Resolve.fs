@@ -0,0 +1,75 @@
+#version 330
+
+// Per frame parameters, see Mandelbrot.fs.
+layout(std140) uniform FrameParams
+{
+    int iterations;
+    bool distanceEstimation;
+    float viewWidth;
+    float viewHeight;
+    float compWidth;
+    float compHeight;
+    float compCenterX;
+    float compCenterY;
+    float seedX;
+    float seedY;
+    int symmetry;
+    int mirrorOffsetX;
+    int mirrorOffsetY;
+};
+
+// Iteration values written by Iterations.fs.
+uniform sampler2D values;
+// Colors computed by another engine, shown as they are when directColors is
+// set.
+uniform sampler2D colors;
+uniform bool directColors = false;
+// Value pixels per window pixel. Below 1 the values only fill the bottom left
+// viewWidth x viewHeight part of the texture and get stretched over the
+// window.
+uniform vec2 valueScale = vec2(1.0);
+
+out vec4 fragColor;
+
+vec4 palette(float slider);
+ivec2 valueTexel(ivec2 p, ivec2 size);
+
+float valueAt(ivec2 p, ivec2 size)
+{
+    return texelFetch(values, valueTexel(clamp(p, ivec2(0), size - 1), size), 0)
+        .r;
+}
+
+void main()
+{
+    if (directColors) {
+        fragColor = vec4(texelFetch(colors, ivec2(gl_FragCoord.xy), 0).rgb, 1.0);
+        return;
+    }
+
+    ivec2 size = ivec2(viewWidth, viewHeight);
+    if (valueScale == vec2(1.0)) {
+        fragColor = palette(valueAt(ivec2(gl_FragCoord.xy), size));
+        return;
+    }
+
+    vec2 p = gl_FragCoord.xy * valueScale - 0.5;
+    ivec2 p0 = ivec2(floor(p));
+    vec2 f = p - vec2(p0);
+    float v00 = valueAt(p0, size);
+    float v10 = valueAt(p0 + ivec2(1, 0), size);
+    float v01 = valueAt(p0 + ivec2(0, 1), size);
+    float v11 = valueAt(p0 + ivec2(1, 1), size);
+
+    // Points inside the set are 1, blending them with escaped neighbours
+    // would draw a band of the brightest colors along the boundary. There the
+    // nearest value is taken instead. Elsewhere interpolating the values
+    // rather than the colors keeps the palette bands smooth.
+    if (max(max(v00, v10), max(v01, v11)) >= 1.0) {
+        fragColor = palette(valueAt(ivec2(floor(p + 0.5)), size));
+        return;
+    }
+    float bottom = mix(v00, v10, f.x);
+    float top = mix(v01, v11, f.x);
+    fragColor = palette(mix(bottom, top, f.y));
+}
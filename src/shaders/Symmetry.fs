@@ -0,0 +1,34 @@
+#version 330
+
+// Per frame parameters, see Mandelbrot.fs.
+layout(std140) uniform FrameParams
+{
+    int iterations;
+    bool distanceEstimation;
+    float viewWidth;
+    float viewHeight;
+    float compWidth;
+    float compHeight;
+    float compCenterX;
+    float compCenterY;
+    float seedX;
+    float seedY;
+    int symmetry;
+    int mirrorOffsetX;
+    int mirrorOffsetY;
+};
+
+// Returns the texel holding the value of pixel p. Pixels that are mirror
+// copies weren't computed, their value is at their mirror image. Keep in sync
+// with Symmetry::isCopy.
+ivec2 valueTexel(ivec2 p, ivec2 size)
+{
+    if (symmetry == 0)
+        return p;
+
+    ivec2 q = ivec2((symmetry == 2) ? mirrorOffsetX - p.x : p.x,
+                    mirrorOffsetY - p.y);
+    bool inFrame = all(greaterThanEqual(q, ivec2(0))) && all(lessThan(q, size));
+    bool isCopy = p.y > q.y || (p.y == q.y && p.x > q.x);
+    return (inFrame && isCopy) ? q : p;
+}
@@ -2,6 +2,8 @@
 
 in vec2 texCoords;
 
+// Signed distance field of the glyphs, 0.5 on the edge and growing inward,
+// see FreeTypeWrapper::loadCharacters.
 uniform sampler2D text;
 uniform vec3 textColor = vec3(1.0, 1.0, 1.0);
 
@@ -9,6 +11,9 @@ out vec4 fragColor;
 
 void main()
 {
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, texCoords).r);
-    fragColor = vec4(textColor, 1.0) * sampled;
+    float distance = texture(text, texCoords).r;
+    // Blend over about a screen pixel whatever the glyphs are scaled to.
+    float width = max(0.7 * fwidth(distance), 1.0e-4);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    fragColor = vec4(textColor, alpha);
 }